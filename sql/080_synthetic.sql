@@ -0,0 +1,36 @@
+SET timezone TO 'Zulu';
+\x
+
+-- generated data set
+SELECT
+    count(*) AS total,
+    count(DISTINCT id) AS unique_ids,
+    count(DISTINCT uuid_v1_get_node(id)) AS nodes,
+    count(DISTINCT uuid_v1_get_clockseq(id)) <= 4 AS clockseq_spread,
+    min(uuid_v1_get_timestamp(id)) >= '2021-08-01' AS after_start,
+    max(uuid_v1_get_timestamp(id)) < '2021-08-01 00:00:20' AS within_rate
+FROM uuid_v1_synthetic(10000, '2021-08-01', 1000, 8, 4, 0, 42) AS s (id);
+
+-- same seed, same data set
+SELECT count(*) AS differences
+FROM (
+    SELECT * FROM uuid_v1_synthetic(10000, '2021-08-01', 1000, 8, 4, 0.25, 42)
+    EXCEPT ALL
+    SELECT * FROM uuid_v1_synthetic(10000, '2021-08-01', 1000, 8, 4, 0.25, 42)
+) AS d;
+
+-- late arrivals
+SELECT
+    count(*) FILTER (WHERE uuid_v1_get_clockseq(id) >= 8192) BETWEEN 2000 AND 3000 AS late_arrivals
+FROM uuid_v1_synthetic(10000, '2021-08-01', 1000, 8, 4, 0.25, 42) AS s (id);
+
+-- late arrivals are unique, even when they crowd the same ticks
+SELECT
+    count(DISTINCT id) = count(*) AS unique_ids,
+    count(*) FILTER (WHERE uuid_v1_get_clockseq(id) >= 8192) > 50000 AS late_arrivals,
+    count(DISTINCT uuid_v1_get_clockseq(id)) FILTER (WHERE uuid_v1_get_clockseq(id) >= 8192) > 1 AS late_clockseqs
+FROM uuid_v1_synthetic(200000, '2021-08-01', 10000000, 2, 1, 0.5, 42) AS s (id);
+
+-- invalid arguments
+SELECT * FROM uuid_v1_synthetic(10, '2021-08-01', 0);
+SELECT * FROM uuid_v1_synthetic(10, '2021-08-01', 1000, 0);
@@ -0,0 +1,76 @@
+SET timezone TO 'Zulu';
+\x
+
+-- array conversion
+SELECT
+    pg_typeof(uuid_v1_convert(ARRAY['edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3'::uuid])) AS from_std,
+    pg_typeof(uuid_v1_convert(ARRAY['edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3'::uuid_v1])) AS to_std,
+    pg_typeof(uuid_v1_parse(ARRAY['edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3'])) AS parse;
+
+SELECT
+    uuid_v1_convert(ARRAY[
+        'edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3',
+        NULL,
+        '4938f30e-8449-11e9-ae2b-e03f49467033'
+    ]::uuid[]) AS from_std,
+    uuid_v1_convert(ARRAY[
+        'edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3',
+        NULL,
+        '4938f30e-8449-11e9-ae2b-e03f49467033'
+    ]::uuid_v1[]) AS to_std,
+    uuid_v1_parse(ARRAY[
+        'edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3',
+        NULL,
+        '{4938f30e-8449-11e9-ae2b-e03f49467033}'
+    ]) AS parse;
+
+-- round trip, keeping dimensions
+WITH data (ids) AS (
+    SELECT ARRAY[
+        ['edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3', '4938f30e-8449-11e9-ae2b-e03f49467033'],
+        ['607ad07c-f95a-11eb-adf0-9d8ba2d04971', '7ca71896-f95a-11eb-adf0-9d8ba2d04971']
+    ]::uuid_v1[]
+)
+SELECT
+    array_dims(uuid_v1_convert(ids)) AS dims,
+    (uuid_v1_convert(uuid_v1_convert(ids)) = ids)::text AS equals_round_trip
+FROM data;
+
+-- NULL's at several positions, spanning more than one byte of the bitmap
+WITH data (ids) AS (
+    SELECT ARRAY[
+        [NULL, 'edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3', NULL],
+        ['4938f30e-8449-11e9-ae2b-e03f49467033', NULL, '607ad07c-f95a-11eb-adf0-9d8ba2d04971'],
+        [NULL, NULL, '7ca71896-f95a-11eb-adf0-9d8ba2d04971']
+    ]::uuid_v1[]
+)
+SELECT
+    uuid_v1_convert(ids) AS to_std,
+    (uuid_v1_convert(uuid_v1_convert(ids)) = ids)::text AS equals_round_trip,
+    (uuid_v1_parse(ids::text[]) = ids)::text AS equals_parse
+FROM data;
+
+-- invalid elements
+SELECT uuid_v1_convert(ARRAY[
+    'edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3',
+    '8f2f5e28-4a6f-4c57-9a0e-3f6b2c1d0e9a'
+]::uuid[]);
+SELECT uuid_v1_parse(ARRAY[
+    'edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3',
+    'edb4d8f0-1a80-11e8-c8d9-e03f49f7f8f3'
+]);
+SELECT uuid_v1_parse(ARRAY['edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3', 'invalid']);
+
+-- skipping invalid elements
+SELECT
+    uuid_v1_convert(ARRAY[
+        '8f2f5e28-4a6f-4c57-9a0e-3f6b2c1d0e9a',
+        'edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3',
+        NULL
+    ]::uuid[], true) AS from_std,
+    uuid_v1_parse(ARRAY[
+        'invalid',
+        'edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3',
+        'edb4d8f0-1a80-11e8-c8d9-e03f49f7f8f3'
+    ], true) AS parse,
+    cardinality(uuid_v1_parse(ARRAY['invalid'], true)) AS empty;
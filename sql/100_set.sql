@@ -0,0 +1,84 @@
+SET timezone TO 'Zulu';
+\x
+
+-- construction, sorted and without duplicates or NULL's
+SELECT
+    uuid_v1_sort_unique(ARRAY[
+        '7ca71896-f95a-11eb-adf0-9d8ba2d04971',
+        'edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3',
+        NULL,
+        '607ad07c-f95a-11eb-adf0-9d8ba2d04971',
+        'edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3'
+    ]::uuid_v1[]) AS sorted,
+    '{7ca71896-f95a-11eb-adf0-9d8ba2d04971,edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3,7ca71896-f95a-11eb-adf0-9d8ba2d04971}'::uuid_v1_set AS parsed,
+    cardinality('{}'::uuid_v1_set::uuid_v1[]) AS empty;
+
+SELECT uuid_v1_sort_unique(ARRAY[['edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3']]::uuid_v1[]);
+SELECT '{{edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3}}'::uuid_v1_set;
+SELECT ARRAY[['edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3']]::uuid_v1[]::uuid_v1_set;
+
+-- no implicit cast to an array, so array operators don't apply to sets
+SELECT '{edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3}'::uuid_v1_set @> ARRAY['edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3']::uuid_v1[];
+
+-- membership
+WITH data (ids) AS (
+    SELECT '{7ca71896-f95a-11eb-adf0-9d8ba2d04971,edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3,607ad07c-f95a-11eb-adf0-9d8ba2d04971}'::uuid_v1_set
+)
+SELECT
+    ('edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3'::uuid_v1 <@ ids)::text AS first,
+    ('7ca71896-f95a-11eb-adf0-9d8ba2d04971'::uuid_v1 <@ ids)::text AS last,
+    ('4938f30e-8449-11e9-ae2b-e03f49467033'::uuid_v1 <@ ids)::text AS missing,
+    (ids @> '607ad07c-f95a-11eb-adf0-9d8ba2d04971'::uuid_v1)::text AS contains,
+    ('edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3'::uuid_v1 <@ '{}'::uuid_v1_set)::text AS empty
+FROM data;
+
+-- large lists, with and without index
+CREATE TABLE set_data AS
+    SELECT id FROM uuid_v1_synthetic(10000, '2024-01-01', nodes => 4, seed => 7) AS id;
+
+CREATE TABLE set_lookup AS
+    SELECT uuid_v1_sort_unique(array_agg(id)) AS ids
+    FROM (SELECT id FROM set_data ORDER BY id DESC LIMIT 100 OFFSET 1000) AS s;
+
+SELECT
+    count(*) AS seqscan,
+    count(*) FILTER (WHERE id = ANY ((SELECT ids FROM set_lookup)::uuid_v1[])) AS any_array
+FROM set_data
+WHERE id <@ (SELECT ids FROM set_lookup);
+
+-- a constant set is only detoasted once
+SELECT ids::text AS ids FROM set_lookup \gset
+SELECT count(*) AS constant_set
+FROM set_data
+WHERE id <@ :'ids'::uuid_v1_set AND :'ids'::uuid_v1_set @> id;
+
+CREATE INDEX set_data_id_idx ON set_data (id);
+ANALYZE set_data;
+SET enable_seqscan TO off;
+
+-- the membership test is an index condition
+\x
+EXPLAIN (COSTS OFF)
+SELECT count(*) AS indexscan
+FROM set_data
+WHERE id <@ (SELECT ids FROM set_lookup);
+\x
+
+SELECT count(*) AS indexscan
+FROM set_data
+WHERE id <@ (SELECT ids FROM set_lookup);
+
+RESET enable_seqscan;
+
+-- binary send and receive
+SELECT '/tmp/uuid_v1_set_' || pg_backend_pid() || '.bin' AS path \gset
+COPY set_lookup TO :'path' (FORMAT binary);
+CREATE TABLE set_copy (ids uuid_v1_set);
+COPY set_copy FROM :'path' (FORMAT binary);
+SELECT 'rm -f ' || :'path' AS rm \gset
+COPY (SELECT) TO PROGRAM :'rm';
+
+SELECT (c.ids::uuid_v1[] = l.ids::uuid_v1[])::text AS equal, cardinality(c.ids::uuid_v1[]) AS cardinality
+FROM set_copy c, set_lookup l;
+
+DROP TABLE set_data, set_lookup, set_copy;
@@ -0,0 +1,67 @@
+SET timezone TO 'Zulu';
+\x
+
+CREATE TABLE bloom_data AS
+    SELECT id FROM uuid_v1_synthetic(10000, '2024-01-01', nodes => 4, seed => 11) AS id;
+
+CREATE TABLE bloom_other AS
+    SELECT id FROM uuid_v1_synthetic(10000, '2024-01-01', nodes => 4, seed => 12) AS id;
+
+CREATE TABLE bloom_filter AS
+    SELECT uuid_v1_bloom_agg(id, 10000, 0.01) AS filter FROM bloom_data;
+
+-- layout, sized for the expected number of elements and false positive rate
+SELECT
+    octet_length(filter::bytea) AS size,
+    substring(filter::bytea FROM 1 FOR 16) AS header
+FROM bloom_filter;
+
+-- no false negatives, few false positives
+SELECT
+    (SELECT count(*) FROM bloom_data, bloom_filter WHERE filter @> id) AS members,
+    (SELECT count(*) FROM bloom_data, bloom_filter WHERE id <@ filter) AS members_commuted,
+    (SELECT count(*) BETWEEN 30 AND 300 FROM bloom_other, bloom_filter WHERE filter @> id)::text AS false_positives;
+
+-- seeded filters store their seed and hash differently
+CREATE TABLE bloom_seeded AS
+    SELECT uuid_v1_bloom_agg(id, 10000, 0.01, 3735928559) AS filter FROM bloom_data;
+
+SELECT
+    substring(s.filter::bytea FROM 9 FOR 4) AS seed,
+    (SELECT count(*) FROM bloom_data WHERE s.filter @> id) AS members,
+    (substring(s.filter::bytea FROM 17) <> substring(f.filter::bytea FROM 17))::text AS different_bits,
+    ((SELECT uuid_v1_bloom_agg(id, 10000, 0.01, 0) FROM bloom_data)::bytea = f.filter::bytea)::text AS default_seed
+FROM bloom_seeded s, bloom_filter f;
+
+-- round trip through bytea, text and parallel aggregation
+SET parallel_setup_cost TO 0;
+SET parallel_tuple_cost TO 0;
+SET min_parallel_table_scan_size TO 0;
+SET max_parallel_workers_per_gather TO 2;
+
+SELECT
+    (filter::bytea::uuid_v1_bloom::bytea = filter::bytea)::text AS bytea_round_trip,
+    (filter::text::uuid_v1_bloom::bytea = filter::bytea)::text AS text_round_trip,
+    ((SELECT uuid_v1_bloom_agg(id, 10000, 0.01) FROM bloom_data)::bytea = filter::bytea)::text AS parallel
+FROM bloom_filter;
+
+SELECT ((SELECT uuid_v1_bloom_agg(id, 10000, 0.01, 3735928559) FROM bloom_data)::bytea = filter::bytea)::text AS parallel_seeded
+FROM bloom_seeded;
+
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_workers_per_gather;
+
+-- empty input
+SELECT (uuid_v1_bloom_agg(id, 10, 0.01) IS NULL)::text AS is_null FROM bloom_data WHERE false;
+
+-- invalid arguments and filters
+SELECT uuid_v1_bloom_agg(id, 0, 0.01) FROM bloom_data;
+SELECT uuid_v1_bloom_agg(id, 10, 1) FROM bloom_data;
+SELECT uuid_v1_bloom_agg(id, 10, 0.01, -1) FROM bloom_data;
+SELECT uuid_v1_bloom_agg(id, 10, 0.01, 4294967296) FROM bloom_data;
+SELECT '\x00'::bytea::uuid_v1_bloom;
+SELECT uuid_v1_bloom('\x5531424601070000000000000000004000'::bytea);
+
+DROP TABLE bloom_data, bloom_other, bloom_filter, bloom_seeded;
@@ -0,0 +1,89 @@
+SET timezone TO 'Zulu';
+\x
+
+-- bucket start, default origin is Monday 2000-01-03
+SELECT
+    to_char(uuid_v1_time_bucket('1 hour', 'ffc449f0-8c2f-11e9-aba7-e03f497ffcbf'), 'YYYY-MM-DD HH24:MI:SS.US') AS hour,
+    to_char(uuid_v1_time_bucket('15 minutes', 'ffc449f0-8c2f-11e9-aba7-e03f497ffcbf', '2019-06-11 09:50Z'), 'YYYY-MM-DD HH24:MI:SS.US') AS origin,
+    to_char(uuid_v1_time_bucket('7 days', '1004cd50-4241-11e9-b3ab-db6f0f573554'), 'YYYY-MM-DD HH24:MI:SS.US') AS week,
+    to_char(uuid_v1_time_bucket('1 day', '1004cd50-4241-11e9-b3ab-db6f0f573554', '2100-01-01 12:00Z'), 'YYYY-MM-DD HH24:MI:SS.US') AS future_origin;
+
+-- lower bound UUID of the bucket
+SELECT
+    uuid_v1_time_bucket_lower('1 hour', 'ffc449f0-8c2f-11e9-aba7-e03f497ffcbf') AS lower,
+    (uuid_v1_time_bucket_lower('1 hour', 'ffc449f0-8c2f-11e9-aba7-e03f497ffcbf') <= 'ffc449f0-8c2f-11e9-aba7-e03f497ffcbf'::uuid_v1)::text AS lower_or_equal,
+    (uuid_v1_time_bucket_lower('1 hour', 'ffc449f0-8c2f-11e9-aba7-e03f497ffcbf') =~ '2019-06-11 10:00Z')::text AS at_bucket_start;
+
+-- invalid bucket widths
+SELECT uuid_v1_time_bucket('1 month', 'ffc449f0-8c2f-11e9-aba7-e03f497ffcbf');
+SELECT uuid_v1_time_bucket('0 seconds', 'ffc449f0-8c2f-11e9-aba7-e03f497ffcbf');
+SELECT uuid_v1_time_bucket('-1 hour', 'ffc449f0-8c2f-11e9-aba7-e03f497ffcbf');
+
+-- origins outside of the UUID timestamp range
+SELECT uuid_v1_time_bucket('1 hour', 'ffc449f0-8c2f-11e9-aba7-e03f497ffcbf', '30000-01-01 00:00Z');
+SELECT uuid_v1_time_bucket('1 hour', 'ffc449f0-8c2f-11e9-aba7-e03f497ffcbf', '1500-01-01 00:00Z');
+SELECT uuid_v1_time_bucket('1 hour', 'ffc449f0-8c2f-11e9-aba7-e03f497ffcbf', 'infinity');
+
+\x
+CREATE TABLE uuid_v1_bucket (id uuid_v1 PRIMARY KEY);
+
+INSERT INTO uuid_v1_bucket (id) VALUES
+('1004cd50-4241-11e9-b3ab-db6f0f573554'), -- 2019-03-09 07:58:02.056840
+('05602550-8a8c-11e9-b3ab-db6f0f573554'), -- 2019-06-09 07:56:00.175240
+('8385ded2-8dbb-11e9-ae2b-db6f0f573554'), -- 2019-06-13 09:13:31.650017
+('ffc449f0-8c2f-11e9-aba7-e03f497ffcbf'), -- 2019-06-11 10:02:19.391640
+('ffc449f0-8c2f-11e9-96b4-e03f49d7f7bb'), -- 2019-06-11 10:02:19.391640
+('ffced5f0-8c2f-11e9-aba7-e03f497ffcbf'), -- 2019-06-11 10:02:19.460760
+('ffd961f0-8c2f-11e9-96b4-e03f49d7f7bb'), -- 2019-06-11 10:02:19.529880
+('002335f0-8c30-11e9-9bb8-e03f4977f7b7'), -- 2019-06-11 10:02:20.013720
+('002dc1f0-8c30-11e9-aba7-e03f497ffcbf')  -- 2019-06-11 10:02:20.082840
+;
+
+ANALYZE uuid_v1_bucket;
+
+SET enable_seqscan TO off;
+
+-- grouping streams from the index without sorting
+EXPLAIN (COSTS OFF)
+SELECT uuid_v1_time_bucket('1 second', id) AS bucket, count(*)
+FROM uuid_v1_bucket
+GROUP BY 1
+ORDER BY 1;
+
+EXPLAIN (COSTS OFF)
+SELECT uuid_v1_time_bucket('1 second', id) AS bucket, count(*)
+FROM uuid_v1_bucket
+GROUP BY 1
+ORDER BY 1 DESC;
+
+SELECT to_char(uuid_v1_time_bucket('1 second', id), 'YYYY-MM-DD HH24:MI:SS') AS bucket, count(*)
+FROM uuid_v1_bucket
+GROUP BY uuid_v1_time_bucket('1 second', id)
+ORDER BY uuid_v1_time_bucket('1 second', id);
+
+SELECT uuid_v1_time_bucket_lower('1 day', id) AS lower, count(*)
+FROM uuid_v1_bucket
+GROUP BY 1
+ORDER BY 1 DESC;
+
+RESET enable_seqscan;
+DROP TABLE uuid_v1_bucket;
+
+-- with default settings, the sorted aggregation pays for its aggregates like
+-- the paths of the planner do, so a hash aggregation is cheaper here
+CREATE TABLE uuid_v1_bucket_agg (id uuid_v1 PRIMARY KEY, value integer);
+
+INSERT INTO uuid_v1_bucket_agg
+    SELECT id, 1 FROM uuid_v1_synthetic(10000, '2024-01-01', 100, seed => 1) AS id
+    ORDER BY id;
+
+VACUUM ANALYZE uuid_v1_bucket_agg;
+
+EXPLAIN (COSTS OFF)
+SELECT uuid_v1_time_bucket('1 second', id) AS bucket,
+    count(*), sum(value), min(value), max(value), avg(value),
+    stddev(value), variance(value), bit_or(value), bit_and(value), count(value)
+FROM uuid_v1_bucket_agg
+GROUP BY 1;
+
+DROP TABLE uuid_v1_bucket_agg;
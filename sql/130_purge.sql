@@ -0,0 +1,43 @@
+\set VERBOSITY terse
+
+CREATE TABLE uuid_v1_purge (id uuid_v1 PRIMARY KEY, payload text);
+
+INSERT INTO uuid_v1_purge (id, payload) VALUES
+('1004cd50-4241-11e9-b3ab-db6f0f573554', 'a'), -- 2019-03-09 07:58:02.056840
+('05602550-8a8c-11e9-b3ab-db6f0f573554', 'b'), -- 2019-06-09 07:56:00.175240
+('8385ded2-8dbb-11e9-ae2b-db6f0f573554', 'c'), -- 2019-06-13 09:13:31.650017
+('ffc449f0-8c2f-11e9-aba7-e03f497ffcbf', 'd'), -- 2019-06-11 10:02:19.391640
+('ffc449f0-8c2f-11e9-96b4-e03f49d7f7bb', 'e'), -- 2019-06-11 10:02:19.391640
+('ffced5f0-8c2f-11e9-aba7-e03f497ffcbf', 'f'), -- 2019-06-11 10:02:19.460760
+('ffd961f0-8c2f-11e9-96b4-e03f49d7f7bb', 'g'), -- 2019-06-11 10:02:19.529880
+('002335f0-8c30-11e9-9bb8-e03f4977f7b7', 'h'), -- 2019-06-11 10:02:20.013720
+('002dc1f0-8c30-11e9-aba7-e03f497ffcbf', 'i')  -- 2019-06-11 10:02:20.082840
+;
+
+-- delete in batches
+CALL uuid_v1_purge_before('uuid_v1_purge', '2019-06-11 10:02:19.5Z', batch_size => 2);
+SELECT payload FROM uuid_v1_purge ORDER BY id;
+
+-- nothing left to delete
+CALL uuid_v1_purge_before('uuid_v1_purge', '2019-06-11 10:02:19.5Z');
+
+-- rate limited, batch size matching the number of rows
+CALL uuid_v1_purge_before('uuid_v1_purge', '2019-06-12Z', batch_size => 3, max_rate => 100);
+SELECT payload FROM uuid_v1_purge ORDER BY id;
+
+-- invalid arguments and tables
+CALL uuid_v1_purge_before('uuid_v1_purge', '2019-06-12Z', batch_size => 0);
+CALL uuid_v1_purge_before('uuid_v1_purge', '2019-06-12Z', max_rate => -1);
+CALL uuid_v1_purge_before('uuid_v1_purge', NULL);
+
+BEGIN;
+CALL uuid_v1_purge_before('uuid_v1_purge', '2019-06-12Z');
+ROLLBACK;
+
+CREATE TABLE uuid_v1_purge_nokey (id uuid_v1);
+CALL uuid_v1_purge_before('uuid_v1_purge_nokey', '2019-06-12Z');
+
+CREATE TABLE uuid_v1_purge_composite (id uuid_v1, seq int, PRIMARY KEY (id, seq));
+CALL uuid_v1_purge_before('uuid_v1_purge_composite', '2019-06-12Z');
+
+DROP TABLE uuid_v1_purge, uuid_v1_purge_nokey, uuid_v1_purge_composite;
@@ -0,0 +1,72 @@
+SET timezone TO 'Zulu';
+\x
+
+CREATE TABLE hll_data AS
+    SELECT id FROM uuid_v1_synthetic(20000, '2024-01-01', rate => 1, nodes => 4, seed => 21) AS id;
+
+-- layout
+SELECT
+    octet_length(uuid_v1_hll_agg(id)::bytea) AS size,
+    substring(uuid_v1_hll_agg(id)::bytea FROM 1 FOR 8) AS header
+FROM hll_data;
+
+-- estimates within three times the standard error
+SELECT
+    (abs(uuid_v1_approx_count_distinct(id) - count(DISTINCT id)) <= 0.025 * count(DISTINCT id))::text AS ids,
+    uuid_v1_approx_distinct_nodes(id) AS nodes,
+    count(DISTINCT uuid_v1_get_node(id)) AS exact_nodes
+FROM hll_data;
+
+-- hourly rollups merge into the sketch of the whole data set
+CREATE TABLE hll_hourly AS
+    SELECT
+        uuid_v1_time_bucket('1 hour', id) AS hour,
+        uuid_v1_hll_agg(id) AS ids,
+        uuid_v1_hll_nodes_agg(id) AS nodes
+    FROM hll_data
+    GROUP BY 1;
+
+SELECT
+    count(*) AS hours,
+    (uuid_v1_hll_union_agg(ids)::bytea = (SELECT uuid_v1_hll_agg(id) FROM hll_data)::bytea)::text AS ids_union,
+    uuid_v1_hll_cardinality(uuid_v1_hll_union_agg(nodes)) AS nodes_union
+FROM hll_hourly;
+
+SELECT
+    (uuid_v1_hll_union(a.ids, b.ids)::bytea = (SELECT uuid_v1_hll_agg(id) FROM hll_data WHERE uuid_v1_time_bucket('1 hour', id) IN (a.hour, b.hour))::bytea)::text AS pair_union
+FROM hll_hourly a, hll_hourly b
+WHERE a.hour = '2024-01-01 00:00' AND b.hour = '2024-01-01 01:00';
+
+-- round trip through bytea, text and parallel aggregation
+SET parallel_setup_cost TO 0;
+SET parallel_tuple_cost TO 0;
+SET min_parallel_table_scan_size TO 0;
+SET max_parallel_workers_per_gather TO 2;
+
+SELECT
+    (sketch::bytea::uuid_v1_hll::bytea = sketch::bytea)::text AS bytea_round_trip,
+    (sketch::text::uuid_v1_hll::bytea = sketch::bytea)::text AS text_round_trip,
+    ((SELECT uuid_v1_hll_agg(id) FROM hll_data)::bytea = sketch::bytea)::text AS parallel,
+    ((SELECT uuid_v1_approx_count_distinct(id) FROM hll_data) = uuid_v1_hll_cardinality(sketch))::text AS parallel_count
+FROM (SELECT uuid_v1_hll_union_agg(ids) AS sketch FROM hll_hourly) s;
+
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_workers_per_gather;
+
+-- empty input
+SELECT
+    uuid_v1_approx_count_distinct(id) AS count,
+    (uuid_v1_hll_agg(id) IS NULL)::text AS is_null
+FROM hll_data WHERE false;
+
+-- sketches of another precision and invalid sketches
+SELECT uuid_v1_hll('\x5531484c0104000000000000000000000000000000000000'::bytea) AS sketch;
+SELECT uuid_v1_hll('\x5531484c0104000000'::bytea);
+SELECT uuid_v1_hll('\x5531484c0102000000000000000000000000000000000000'::bytea);
+SELECT uuid_v1_hll('\x5531484c01040000000000000000000000000000003e0000'::bytea);
+SELECT '\x5531484c01040000000000000000000000000000003e0000'::uuid_v1_hll;
+SELECT uuid_v1_hll_union(ids, uuid_v1_hll('\x5531484c0104000000000000000000000000000000000000'::bytea)) FROM hll_hourly;
+
+DROP TABLE hll_data, hll_hourly;
@@ -0,0 +1,72 @@
+SET timezone TO 'Zulu';
+\x
+
+CREATE TABLE oq_ordered AS
+    SELECT id FROM uuid_v1_synthetic(10000, '2024-01-01', nodes => 4, seed => 31) AS id;
+
+CREATE TABLE oq_late AS
+    SELECT id FROM uuid_v1_synthetic(10000, '2024-01-01', nodes => 4, disorder => 0.1, seed => 31) AS id;
+
+-- rows stored in time order
+SELECT
+    pages,
+    rows,
+    out_of_order,
+    max_lateness,
+    round(correlation::numeric, 3) AS correlation,
+    round(cluster_gain::numeric, 3) AS cluster_gain
+FROM uuid_v1_order_quality('oq_ordered', exact => true)
+WHERE node IS NULL;
+
+SELECT
+    count(*) AS nodes,
+    sum(rows) AS rows,
+    sum(out_of_order) AS out_of_order,
+    (min(correlation) > 0.99)::text AS correlation
+FROM uuid_v1_order_quality('oq_ordered', exact => true)
+WHERE node IS NOT NULL;
+
+-- late arrivals
+SELECT
+    rows,
+    (out_of_order_fraction BETWEEN 0.05 AND 0.15)::text AS out_of_order,
+    (max_lateness BETWEEN '1 millisecond' AND '2 seconds')::text AS max_lateness,
+    (correlation BETWEEN 0.9 AND 1)::text AS correlation
+FROM uuid_v1_order_quality('oq_late', exact => true)
+WHERE node IS NULL;
+
+-- small tables are read completely in sampled mode
+SELECT (
+    (SELECT array_agg(q ORDER BY q.node NULLS FIRST)::text FROM uuid_v1_order_quality('oq_late') q) =
+    (SELECT array_agg(q ORDER BY q.node NULLS FIRST)::text FROM uuid_v1_order_quality('oq_late', exact => true) q)
+)::text AS sampled_equals_exact;
+
+-- leaf pages of an index built in order, and after inserts in the middle
+CREATE INDEX oq_late_idx ON oq_late (id);
+
+SELECT
+    (pages > 1)::text AS pages,
+    out_of_order,
+    round(leaf_fill::numeric, 1) AS leaf_fill,
+    (correlation > 0.99)::text AS correlation
+FROM uuid_v1_order_quality('oq_late_idx', exact => true);
+
+INSERT INTO oq_late
+    SELECT id FROM uuid_v1_synthetic(2000, '2024-01-01 00:00:05', nodes => 2, seed => 32) AS id;
+
+SELECT
+    (out_of_order > 0)::text AS out_of_order,
+    (leaf_fill < 0.9)::text AS leaf_fill
+FROM uuid_v1_order_quality('oq_late_idx', exact => true);
+
+-- unsupported relations
+CREATE TABLE oq_none (a integer);
+CREATE VIEW oq_view AS SELECT 1 AS a;
+CREATE INDEX oq_late_node_idx ON oq_late (id uuid_v1_node_ops);
+
+SELECT * FROM uuid_v1_order_quality('oq_none');
+SELECT * FROM uuid_v1_order_quality('oq_view');
+SELECT * FROM uuid_v1_order_quality('oq_late_node_idx');
+
+DROP VIEW oq_view;
+DROP TABLE oq_ordered, oq_late, oq_none;
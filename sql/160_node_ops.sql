@@ -0,0 +1,79 @@
+SET timezone TO 'Zulu';
+\x
+
+-- node order compared to the default time order
+SELECT
+    ('b4cc8000-a838-11ee-8000-ff0b0c0d0e0f'::uuid_v1 < 'bac26100-a838-11ee-8000-000b0c0d0e0f'::uuid_v1)::text AS time_order,
+    ('b4cc8000-a838-11ee-8000-ff0b0c0d0e0f'::uuid_v1 <# 'bac26100-a838-11ee-8000-000b0c0d0e0f'::uuid_v1)::text AS node_order,
+    ('b4cc8000-a838-11ee-8000-0a0b0c0d0e0f'::uuid_v1 <# 'bac26100-a838-11ee-8000-0a0b0c0d0e0f'::uuid_v1)::text AS same_node,
+    ('bac26100-a838-11ee-8000-0a0b0c0d0e0f'::uuid_v1 >=# 'bac26100-a838-11ee-8000-0a0b0c0d0e0f'::uuid_v1)::text AS greater_or_equal;
+
+-- node prefix comparison
+SELECT
+    ('b4cc8000-a838-11ee-8000-0a0b0c0d0e0f'::uuid_v1 =# '\x0a0b0c0d0e0f'::bytea)::text AS equal,
+    ('b4cc8000-a838-11ee-8000-0a0b0c0d0e0f'::uuid_v1 ># '\x0a0b0c0d0e'::bytea)::text AS longer,
+    ('b4cc8000-a838-11ee-8000-0a0b0c0d0e0f'::uuid_v1 <# '\x0a0b0c0d0e0f00'::bytea)::text AS shorter,
+    ('b4cc8000-a838-11ee-8000-0a0b0c0d0e0f'::uuid_v1 <=# '\x0b'::bytea)::text AS lower;
+
+-- smallest UUID of a node at a timestamp
+SELECT
+    uuid_v1_node_lower('\x0a0b0c0d0e0f', '2024-01-01 00:00:05Z') AS lower,
+    (uuid_v1_node_lower('\x0a0b0c0d0e0f', '2024-01-01 00:00:05Z') =~ '2024-01-01 00:00:05Z')::text AS at_timestamp;
+
+SELECT uuid_v1_node_lower('\x0a0b', '2024-01-01 00:00:05Z');
+SELECT uuid_v1_node_lower('\x0a0b0c0d0e0f', '-infinity');
+SELECT uuid_v1_node_lower('\x0a0b0c0d0e0f', '1500-01-01 00:00:00Z');
+SELECT uuid_v1_node_lower('\x0a0b0c0d0e0f', '30000-01-01 00:00:00Z');
+
+\x
+CREATE TABLE node_ops_test AS
+    SELECT id FROM uuid_v1_synthetic(20000, '2024-01-01', nodes => 4, seed => 41) AS id;
+
+-- sorting agrees with sorting by node first
+SELECT count(*) AS differences
+FROM (
+    SELECT
+        row_number() OVER (ORDER BY id USING <#) AS node_order,
+        row_number() OVER (ORDER BY uuid_v1_get_node(id), id) AS expected_order
+    FROM node_ops_test
+) s
+WHERE node_order <> expected_order;
+
+CREATE INDEX node_ops_test_idx ON node_ops_test (id uuid_v1_node_ops);
+
+VACUUM ANALYZE node_ops_test;
+
+SET enable_seqscan TO off;
+
+EXPLAIN (COSTS OFF)
+SELECT count(*) FROM node_ops_test WHERE id =# '\x0a0b0c0d0e0f';
+
+EXPLAIN (COSTS OFF)
+SELECT id FROM node_ops_test
+WHERE id >=# uuid_v1_node_lower('\x0a0b0c0d0e0f', '2024-01-01 00:00:05Z')
+  AND id <# uuid_v1_node_lower('\x0a0b0c0d0e0f', '2024-01-01 00:00:10Z')
+ORDER BY id USING <#;
+
+SELECT uuid_v1_get_node(id) AS node FROM node_ops_test LIMIT 1 \gset
+
+-- index scans find the same rows as filters
+SELECT
+    (SELECT count(*) FROM node_ops_test WHERE id =# :'node'::bytea) =
+    (SELECT count(*) FROM node_ops_test WHERE uuid_v1_get_node(id) = :'node'::bytea) AS node_rows,
+    (SELECT count(*) FROM node_ops_test WHERE id <# :'node'::bytea) =
+    (SELECT count(*) FROM node_ops_test WHERE uuid_v1_get_node(id) < :'node'::bytea) AS lower_rows,
+    (SELECT count(*) FROM node_ops_test WHERE id ># :'node'::bytea) =
+    (SELECT count(*) FROM node_ops_test WHERE uuid_v1_get_node(id) > :'node'::bytea) AS upper_rows,
+    (SELECT count(*) FROM node_ops_test
+     WHERE id >=# uuid_v1_node_lower(:'node', '2024-01-01 00:00:05Z')
+       AND id <# uuid_v1_node_lower(:'node', '2024-01-01 00:00:10Z')) =
+    (SELECT count(*) FROM node_ops_test
+     WHERE uuid_v1_get_node(id) = :'node'::bytea
+       AND id >=~ '2024-01-01 00:00:05Z' AND id <~ '2024-01-01 00:00:10Z') AS range_rows,
+    (SELECT count(*) FROM node_ops_test
+     WHERE id >=# uuid_v1_node_lower(:'node', '2024-01-01 00:00:05Z')
+       AND id <# uuid_v1_node_lower(:'node', '2024-01-01 00:00:10Z')) > 0 AS range_not_empty;
+
+RESET enable_seqscan;
+
+DROP TABLE node_ops_test;
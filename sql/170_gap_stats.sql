@@ -0,0 +1,99 @@
+SET timezone TO 'Zulu';
+\x
+
+CREATE TABLE gap_stats_test AS
+    SELECT id FROM uuid_v1_synthetic(20000, '2024-01-01', nodes => 4, seed => 41) AS id;
+
+CREATE TABLE gap_stats_late AS
+    SELECT id FROM uuid_v1_synthetic(20000, '2024-01-01', nodes => 4, disorder => 0.1, seed => 41) AS id;
+
+-- 4 nodes at 250 UUID's per second each, exponentially distributed gaps
+SELECT
+    (s).gaps,
+    (s).out_of_order,
+    ((s).p50 BETWEEN '2.6 ms' AND '3 ms')::text AS p50,
+    ((s).p99 BETWEEN '17 ms' AND '19.5 ms')::text AS p99,
+    ((s).max BETWEEN '37 ms' AND '38 ms')::text AS max
+FROM (SELECT uuid_v1_gap_stats(id ORDER BY id) AS s FROM gap_stats_test) q;
+
+-- input already in order
+SELECT (
+    (SELECT uuid_v1_gap_stats(id) FROM (SELECT id FROM gap_stats_test ORDER BY id) s) =
+    (SELECT uuid_v1_gap_stats(id ORDER BY id) FROM gap_stats_test)
+)::text AS same_stats;
+
+-- late arrivals are skipped, unless the input is sorted
+SELECT
+    ((s).out_of_order BETWEEN 1500 AND 2500)::text AS out_of_order,
+    ((s).gaps + (s).out_of_order = 19996)::text AS total
+FROM (SELECT uuid_v1_gap_stats(id) AS s FROM gap_stats_late) q;
+
+SELECT (s).gaps, (s).out_of_order
+FROM (SELECT uuid_v1_gap_stats(id ORDER BY id) AS s FROM gap_stats_late) q;
+
+-- partial aggregates of partitions by time
+CREATE TABLE gap_stats_parts (id uuid_v1) PARTITION BY RANGE (id);
+CREATE TABLE gap_stats_parts_1 PARTITION OF gap_stats_parts
+    FOR VALUES FROM (MINVALUE) TO ('bac26100-a838-11ee-8000-000000000000');
+CREATE TABLE gap_stats_parts_2 PARTITION OF gap_stats_parts
+    FOR VALUES FROM ('bac26100-a838-11ee-8000-000000000000') TO (MAXVALUE);
+
+INSERT INTO gap_stats_parts SELECT id FROM gap_stats_test;
+
+SET enable_partitionwise_aggregate TO on;
+
+\x
+EXPLAIN (COSTS OFF)
+SELECT uuid_v1_gap_stats(id) FROM gap_stats_parts;
+\x
+
+SELECT
+    ((p).gaps = (s).gaps)::text AS gaps,
+    ((p).max = (s).max)::text AS max,
+    (abs(extract(epoch FROM (p).p50 - (s).p50)) < 0.0001)::text AS p50
+FROM
+    (SELECT uuid_v1_gap_stats(id) AS p FROM gap_stats_parts) parts,
+    (SELECT uuid_v1_gap_stats(id ORDER BY id) AS s FROM gap_stats_test) whole;
+
+-- partial inputs overlapping in time count as out of order
+CREATE TABLE gap_stats_mixed (id uuid_v1, part integer) PARTITION BY LIST (part);
+CREATE TABLE gap_stats_mixed_0 PARTITION OF gap_stats_mixed FOR VALUES IN (0);
+CREATE TABLE gap_stats_mixed_1 PARTITION OF gap_stats_mixed FOR VALUES IN (1);
+
+INSERT INTO gap_stats_mixed
+    SELECT id, row_number() OVER (ORDER BY id) % 2 FROM gap_stats_test;
+
+SELECT
+    ((s).out_of_order > 0)::text AS out_of_order,
+    (s).gaps + (s).out_of_order AS total
+FROM (SELECT uuid_v1_gap_stats(id) AS s FROM gap_stats_mixed) q;
+
+RESET enable_partitionwise_aggregate;
+
+-- no partial aggregates in parallel workers, whose inputs always interleave
+SET parallel_setup_cost TO 0;
+SET parallel_tuple_cost TO 0;
+SET min_parallel_table_scan_size TO 0;
+SET max_parallel_workers_per_gather TO 2;
+
+\x
+EXPLAIN (COSTS OFF)
+SELECT uuid_v1_gap_stats(id) FROM gap_stats_test;
+\x
+
+SELECT (s).gaps + (s).out_of_order AS total
+FROM (SELECT uuid_v1_gap_stats(id) AS s FROM gap_stats_test) q;
+
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_workers_per_gather;
+
+-- no gaps
+SELECT (uuid_v1_gap_stats(id) IS NULL)::text AS no_input
+FROM gap_stats_test WHERE false;
+
+SELECT (s).gaps, ((s).p50 IS NULL AND (s).max IS NULL)::text AS no_gaps
+FROM (SELECT uuid_v1_gap_stats(id) AS s FROM gap_stats_test WHERE id = (SELECT id FROM gap_stats_test ORDER BY id LIMIT 1)) q;
+
+DROP TABLE gap_stats_test, gap_stats_late, gap_stats_parts, gap_stats_mixed;
@@ -0,0 +1,111 @@
+SET timezone TO 'Zulu';
+\x
+
+-- three version 1 UUID's and a version 4 one
+SELECT lo_from_bytea(0,
+    uuid_send('ffc449f0-8c2f-11e9-aba7-e03f497ffcbf') ||
+    uuid_send('1004cd50-4241-11e9-b3ab-db6f0f573554') ||
+    uuid_send('a0eebc99-9c0b-4ef8-bb6d-6bb9bd380a11') ||
+    uuid_send('05602550-8a8c-11e9-b3ab-db6f0f573554')) AS lo \gset
+-- per backend paths, so concurrent runs can't collide
+SELECT
+    '/tmp/uuid_v1_read_binary_' || pg_backend_pid() || '.bin' AS path,
+    '/tmp/uuid_v1_read_binary_truncated_' || pg_backend_pid() || '.bin' AS truncated,
+    '/tmp/uuid_v1_read_binary_large_' || pg_backend_pid() || '.bin' AS large \gset
+SELECT lo_export(:lo, :'path');
+SELECT lo_unlink(:lo);
+
+SELECT array_agg(id) FROM uuid_v1_read_binary(:'path', skip_invalid => true) AS id;
+
+-- offset and count are in records
+SELECT array_agg(id) FROM uuid_v1_read_binary(:'path', 1, 1) AS id;
+
+SELECT array_agg(id) FROM uuid_v1_read_binary(:'path', 3) AS id;
+
+SELECT count(*) FROM uuid_v1_read_binary(:'path', 10) AS id;
+
+SELECT count(*) FROM uuid_v1_read_binary(:'path', count => 0) AS id;
+
+-- invalid values and arguments, without the per backend path in the output
+\set VERBOSITY terse
+SELECT count(*) FROM uuid_v1_read_binary(:'path') AS id;
+\set VERBOSITY default
+SELECT count(*) FROM uuid_v1_read_binary(:'path', -1) AS id;
+SELECT count(*) FROM uuid_v1_read_binary(:'path', count => -1) AS id;
+SELECT count(*) FROM uuid_v1_read_binary(:'path', NULL) AS id;
+
+-- truncated file
+SELECT lo_from_bytea(0, uuid_send('ffc449f0-8c2f-11e9-aba7-e03f497ffcbf') || '\x00'::bytea) AS lo \gset
+SELECT lo_export(:lo, :'truncated');
+SELECT lo_unlink(:lo);
+
+\set VERBOSITY sqlstate
+SELECT count(*) FROM uuid_v1_read_binary(:'truncated') AS id;
+\set VERBOSITY default
+
+-- only for superusers
+CREATE ROLE regress_uuid_v1_read_binary;
+SET ROLE regress_uuid_v1_read_binary;
+SELECT count(*) FROM uuid_v1_read_binary(:'path') AS id;
+RESET ROLE;
+DROP ROLE regress_uuid_v1_read_binary;
+
+-- round trip, spanning several chunks
+CREATE TABLE read_binary_test AS
+    SELECT id FROM uuid_v1_synthetic(20000, '2024-01-01', nodes => 4, seed => 41) AS id;
+
+SELECT lo_from_bytea(0, string_agg(uuid_send(uuid_v1_convert(id)), ''::bytea ORDER BY id)) AS lo
+FROM read_binary_test \gset
+SELECT lo_export(:lo, :'large');
+SELECT lo_unlink(:lo);
+
+SELECT
+    (SELECT count(*) FROM uuid_v1_read_binary(:'large')) AS count,
+    (SELECT count(*) FROM (
+        SELECT id FROM read_binary_test
+        EXCEPT ALL
+        SELECT id FROM uuid_v1_read_binary(:'large') AS id
+    ) q) AS differences;
+
+-- records are returned in file order
+SELECT count(*) AS count, bool_and(f.id = t.id)::text AS same_order
+FROM uuid_v1_read_binary(:'large', 8000, 10000) WITH ORDINALITY AS f (id, n)
+JOIN (SELECT id, row_number() OVER (ORDER BY id) AS n FROM read_binary_test) t ON t.n = f.n + 8000;
+
+-- streamed in the select list, also when run to completion in a rescan
+\x
+EXPLAIN (COSTS OFF)
+SELECT uuid_v1_read_binary(:'large');
+\x
+
+SELECT count(*) AS count, count(DISTINCT r.id) AS distinct_ids
+FROM generate_series(1, 3) AS g,
+     LATERAL (SELECT uuid_v1_read_binary(:'large', g * 1000, 5000) AS id) AS r;
+
+SELECT count(*) AS count
+FROM (SELECT uuid_v1_read_binary(:'large') AS id LIMIT 10) AS r;
+
+-- a file truncated while it is read raises an error
+CREATE FUNCTION read_binary_truncate(path text) RETURNS boolean
+LANGUAGE plpgsql AS $$
+BEGIN
+    IF current_setting('read_binary.truncated', true) IS DISTINCT FROM 'on' THEN
+        EXECUTE format('COPY (SELECT) TO PROGRAM %L', 'truncate -s 0 ' || path);
+        PERFORM set_config('read_binary.truncated', 'on', false);
+    END IF;
+    RETURN true;
+END
+$$;
+
+\set VERBOSITY sqlstate
+SELECT count(*) AS count
+FROM (SELECT uuid_v1_read_binary(:'large') AS id) AS r
+WHERE read_binary_truncate(:'large');
+\set VERBOSITY default
+
+DROP FUNCTION read_binary_truncate(text);
+
+SELECT 'rm -f ' || :'path' || ' ' || :'truncated' || ' ' || :'large' AS rm \gset
+COPY (SELECT) TO PROGRAM :'rm';
+
+DROP TABLE read_binary_test;
@@ -0,0 +1,34 @@
+SET timezone TO 'Zulu';
+\x
+
+-- without shared_preload_libraries the monitor is not available
+SELECT * FROM uuid_v1_node_lag;
+SELECT uuid_v1_node_lag_reset();
+
+CREATE TABLE node_lag_data (id uuid_v1);
+CREATE TRIGGER node_lag_data_lag BEFORE INSERT ON node_lag_data
+    FOR EACH ROW EXECUTE FUNCTION uuid_v1_node_lag_trigger('id');
+
+INSERT INTO node_lag_data VALUES ('edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3');
+
+-- protocol violations are reported first
+DROP TRIGGER node_lag_data_lag ON node_lag_data;
+CREATE TRIGGER node_lag_data_lag AFTER UPDATE ON node_lag_data
+    FOR EACH ROW EXECUTE FUNCTION uuid_v1_node_lag_trigger('id');
+INSERT INTO node_lag_data VALUES ('edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3');
+UPDATE node_lag_data SET id = id;
+
+DROP TABLE node_lag_data;
+
+-- only superusers may reset the statistics
+CREATE ROLE uuid_v1_node_lag_user;
+
+SELECT
+    has_function_privilege('uuid_v1_node_lag_user', 'uuid_v1_node_lag()', 'EXECUTE')::text AS view,
+    has_function_privilege('uuid_v1_node_lag_user', 'uuid_v1_node_lag_reset()', 'EXECUTE')::text AS reset;
+
+SET ROLE uuid_v1_node_lag_user;
+SELECT uuid_v1_node_lag_reset();
+RESET ROLE;
+
+DROP ROLE uuid_v1_node_lag_user;
@@ -0,0 +1,64 @@
+SET timezone TO 'Zulu';
+\x
+
+CREATE TABLE node_lag_data (id uuid_v1);
+CREATE TRIGGER node_lag_data_lag BEFORE INSERT ON node_lag_data
+    FOR EACH ROW EXECUTE FUNCTION uuid_v1_node_lag_trigger('id');
+
+SELECT uuid_v1_node_lag_reset();
+SELECT count(*) AS nodes FROM uuid_v1_node_lag;
+
+-- a late row and two changes of the clock sequence, the NULL is ignored
+INSERT INTO node_lag_data VALUES ('edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3');
+INSERT INTO node_lag_data VALUES ('4938f30e-8449-11e9-ae2b-e03f49f7f8f3');
+INSERT INTO node_lag_data VALUES ('edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3');
+INSERT INTO node_lag_data VALUES (NULL);
+
+-- a node with its clock ahead
+INSERT INTO node_lag_data VALUES ('b5a6c000-dd56-1243-98d9-5a1b2c3d4e5f');
+
+SELECT
+    node,
+    rows,
+    late_rows,
+    last_seen > now() - interval '1 hour' AS recent,
+    newest,
+    max_clock_ahead > interval '50 years' AS ahead,
+    clock_seq,
+    clock_seq_changes,
+    lag_histogram,
+    lag < interval '0' AS negative_lag
+FROM uuid_v1_node_lag
+ORDER BY node;
+
+-- more nodes than can be tracked are counted in a separate row
+INSERT INTO node_lag_data
+    SELECT id FROM uuid_v1_synthetic(1000, '2021-08-01', nodes => 32, seed => 3) AS id;
+
+SELECT
+    count(node) AS nodes,
+    sum(rows) AS rows,
+    sum(rows) FILTER (WHERE node IS NULL) > 0 AS overflow
+FROM uuid_v1_node_lag;
+
+SELECT uuid_v1_node_lag_reset();
+SELECT count(*) AS nodes FROM uuid_v1_node_lag;
+
+DROP TABLE node_lag_data;
+
+-- only uuid_v1 columns (or domains over it) can be tracked
+CREATE DOMAIN node_lag_id AS uuid_v1;
+CREATE TABLE node_lag_domain (id node_lag_id);
+CREATE TRIGGER node_lag_domain_lag BEFORE INSERT ON node_lag_domain
+    FOR EACH ROW EXECUTE FUNCTION uuid_v1_node_lag_trigger('id');
+INSERT INTO node_lag_domain VALUES ('edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3');
+
+CREATE TABLE node_lag_uuid (id uuid);
+CREATE TRIGGER node_lag_uuid_lag BEFORE INSERT ON node_lag_uuid
+    FOR EACH ROW EXECUTE FUNCTION uuid_v1_node_lag_trigger('id');
+INSERT INTO node_lag_uuid VALUES ('edb4d8f0-1a80-11e8-98d9-e03f49f7f8f3');
+
+SELECT node, rows FROM uuid_v1_node_lag;
+
+DROP TABLE node_lag_domain, node_lag_uuid;
+DROP DOMAIN node_lag_id;
@@ -0,0 +1,113 @@
+SET timezone TO 'Zulu';
+SET max_parallel_workers_per_gather TO 0;
+\x
+
+CREATE TABLE time_map_data (id uuid_v1, payload integer);
+
+INSERT INTO time_map_data
+    SELECT id, row_number() OVER (ORDER BY id)
+    FROM uuid_v1_synthetic(200000, '2024-01-01', 5, seed => 11) AS id
+    ORDER BY id;
+
+VACUUM (FREEZE, ANALYZE) time_map_data;
+
+-- ratio of the cost of the custom scan to the one of a sequential scan
+CREATE FUNCTION time_map_cost(query text) RETURNS float8
+LANGUAGE plpgsql AS $$
+DECLARE
+    plan json;
+    custom float8;
+BEGIN
+    EXECUTE 'EXPLAIN (FORMAT JSON) ' || query INTO plan;
+    custom := (plan->0->'Plan'->'Plans'->0->>'Total Cost')::float8;
+    SET LOCAL uuid_v1.time_map TO off;
+    EXECUTE 'EXPLAIN (FORMAT JSON) ' || query INTO plan;
+    RETURN round((custom / (plan->0->'Plan'->'Plans'->0->>'Total Cost')::float8)::numeric, 2);
+END
+$$;
+
+-- without summaries, nothing can be skipped
+\x
+EXPLAIN (COSTS OFF)
+SELECT count(*) FROM time_map_data
+WHERE id >=~ '2024-01-01 05:00' AND id <~ '2024-01-01 06:00';
+\x
+
+SELECT uuid_v1_time_map_summarize('time_map_data', 'id');
+SELECT uuid_v1_time_map_summarize('time_map_data', 'payload');
+SELECT uuid_v1_time_map_summarize('time_map_data', 'missing');
+
+-- with summaries, the custom scan is costed by the ranges it skips
+\x
+EXPLAIN (COSTS OFF)
+SELECT count(*) FROM time_map_data
+WHERE id >=~ '2024-01-01 05:00' AND id <~ '2024-01-01 06:00';
+\x
+
+SELECT time_map_cost($$
+    SELECT count(*) FROM time_map_data
+    WHERE id >=~ '2024-01-01 05:00' AND id <~ '2024-01-01 06:00'
+$$) AS cost_ratio;
+
+-- a condition matching every range is left to a sequential scan
+\x
+EXPLAIN (COSTS OFF)
+SELECT count(*) FROM time_map_data
+WHERE id >=~ '2024-01-01 00:00';
+
+-- the scan skips the summarized ranges, and summarizes the ranges it reads
+EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF)
+SELECT count(*) FROM time_map_data
+WHERE id >=~ '2024-01-01 05:00' AND id <~ '2024-01-01 06:00';
+\x
+
+-- same rows as a sequential scan
+CREATE VIEW time_map_result AS
+    SELECT count(*) AS count, sum(payload) AS sum, min(payload) AS min, max(payload) AS max
+    FROM time_map_data
+    WHERE id >=~ '2024-01-01 05:00' AND id <~ '2024-01-01 06:00';
+
+SELECT * FROM time_map_result;
+SET uuid_v1.time_map TO off;
+SELECT * FROM time_map_result;
+RESET uuid_v1.time_map;
+
+-- changes to a summarized range, which used to be skipped
+UPDATE time_map_data
+SET id = (SELECT id FROM time_map_data WHERE id >=~ '2024-01-01 05:30' ORDER BY id LIMIT 1)
+WHERE payload = 1;
+DELETE FROM time_map_data WHERE payload = 2;
+
+SELECT * FROM time_map_result;
+SET uuid_v1.time_map TO off;
+SELECT * FROM time_map_result;
+RESET uuid_v1.time_map;
+
+-- the changed range is read until it has been vacuumed and summarized again
+\x
+EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF)
+SELECT count(*) FROM time_map_data
+WHERE id >=~ '2024-01-01 05:00' AND id <~ '2024-01-01 06:00';
+\x
+
+VACUUM time_map_data;
+SELECT count FROM time_map_result;
+
+\x
+EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF)
+SELECT count(*) FROM time_map_data
+WHERE id >=~ '2024-01-01 05:00' AND id <~ '2024-01-01 06:00';
+\x
+
+-- changes within the matching range
+DELETE FROM time_map_data
+WHERE id >=~ '2024-01-01 05:10' AND id <~ '2024-01-01 05:20';
+
+SELECT * FROM time_map_result;
+SET uuid_v1.time_map TO off;
+SELECT * FROM time_map_result;
+RESET uuid_v1.time_map;
+
+DROP VIEW time_map_result;
+DROP FUNCTION time_map_cost(text);
+DROP TABLE time_map_data;
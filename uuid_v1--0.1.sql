@@ -56,6 +56,19 @@ CREATE FUNCTION uuid_v1_convert(uuid) RETURNS uuid_v1
 AS 'MODULE_PATHNAME', 'uuid_v1_conv_from_std'
 LANGUAGE C IMMUTABLE LEAKPROOF STRICT PARALLEL SAFE;
 
+-- bulk type conversion helper functions
+CREATE FUNCTION uuid_v1_convert(uuid_v1[]) RETURNS uuid[]
+AS 'MODULE_PATHNAME', 'uuid_v1_conv_to_std_array'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_convert(uuid[], skip_invalid boolean DEFAULT false) RETURNS uuid_v1[]
+AS 'MODULE_PATHNAME', 'uuid_v1_conv_from_std_array'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_parse(text[], skip_invalid boolean DEFAULT false) RETURNS uuid_v1[]
+AS 'MODULE_PATHNAME', 'uuid_v1_parse_array'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
 
 -- helper functions to extract encoded information
 CREATE FUNCTION uuid_v1_get_timestamp(uuid_v1) RETURNS timestamp with time zone
@@ -328,3 +341,787 @@ CREATE OPERATOR CLASS uuid_v1_ops DEFAULT FOR TYPE uuid_v1
         FUNCTION        1       uuid_v1_cmp_ts(uuid_v1, timestamp with time zone),
         FUNCTION        2       uuid_v1_sortsupport(internal)
 ;
+
+
+-- ingest lag and clock skew monitor (requires shared_preload_libraries)
+CREATE FUNCTION uuid_v1_node_lag_trigger()
+RETURNS trigger
+AS 'MODULE_PATHNAME', 'uuid_v1_node_lag_trigger'
+LANGUAGE C;
+
+COMMENT ON FUNCTION uuid_v1_node_lag_trigger() IS 'track ingest lag of inserted UUID''s per node';
+
+CREATE FUNCTION uuid_v1_node_lag(
+    OUT node bytea,
+    OUT rows bigint,
+    OUT late_rows bigint,
+    OUT last_seen timestamp with time zone,
+    OUT newest timestamp with time zone,
+    OUT max_clock_ahead interval,
+    OUT clock_seq smallint,
+    OUT clock_seq_changes bigint,
+    OUT lag_histogram bigint[]
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME', 'uuid_v1_node_lag'
+LANGUAGE C STRICT VOLATILE PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_node_lag() IS 'ingest lag statistics per node';
+
+CREATE FUNCTION uuid_v1_node_lag_reset()
+RETURNS void
+AS 'MODULE_PATHNAME', 'uuid_v1_node_lag_reset'
+LANGUAGE C STRICT VOLATILE PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_node_lag_reset() IS 'reset ingest lag statistics';
+
+REVOKE ALL ON FUNCTION uuid_v1_node_lag_reset() FROM PUBLIC;
+
+CREATE VIEW uuid_v1_node_lag AS
+    SELECT *, now() - newest AS lag
+    FROM uuid_v1_node_lag();
+
+
+-- synthetic workload generator
+CREATE FUNCTION uuid_v1_synthetic_support(internal)
+RETURNS internal
+AS 'MODULE_PATHNAME', 'uuid_v1_synthetic_support'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_synthetic_support(internal) IS 'planner support for uuid_v1_synthetic';
+
+CREATE FUNCTION uuid_v1_synthetic(
+    count bigint,
+    start timestamp with time zone,
+    rate float8 DEFAULT 1000,
+    nodes integer DEFAULT 1,
+    clockseq_spread integer DEFAULT 1,
+    disorder float8 DEFAULT 0,
+    seed bigint DEFAULT 0
+)
+RETURNS SETOF uuid_v1
+AS 'MODULE_PATHNAME', 'uuid_v1_synthetic'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+SUPPORT uuid_v1_synthetic_support;
+
+COMMENT ON FUNCTION uuid_v1_synthetic(bigint, timestamp with time zone, float8, integer, integer, float8, bigint) IS 'generate synthetic UUID v1 values';
+
+
+-- sorted set of UUID's for membership tests against large lists
+CREATE TYPE uuid_v1_set;
+
+CREATE FUNCTION uuid_v1_set_in(cstring)
+RETURNS uuid_v1_set
+AS 'MODULE_PATHNAME', 'uuid_v1_set_in'
+LANGUAGE C STABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_set_out(uuid_v1_set)
+RETURNS cstring
+AS 'MODULE_PATHNAME', 'uuid_v1_set_out'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_set_recv(internal)
+RETURNS uuid_v1_set
+AS 'MODULE_PATHNAME', 'uuid_v1_set_recv'
+LANGUAGE C STABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_set_send(uuid_v1_set)
+RETURNS bytea
+AS 'MODULE_PATHNAME', 'uuid_v1_set_send'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE TYPE uuid_v1_set (
+    INTERNALLENGTH = VARIABLE,
+    INPUT = uuid_v1_set_in,
+    OUTPUT = uuid_v1_set_out,
+    RECEIVE = uuid_v1_set_recv,
+    SEND = uuid_v1_set_send,
+    STORAGE = extended,
+    ALIGNMENT = double
+);
+
+CREATE FUNCTION uuid_v1_sort_unique(uuid_v1[])
+RETURNS uuid_v1_set
+AS 'MODULE_PATHNAME', 'uuid_v1_sort_unique'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_sort_unique(uuid_v1[]) IS 'sorted set of the distinct, non-null elements';
+
+CREATE FUNCTION uuid_v1_set_to_array(uuid_v1_set)
+RETURNS uuid_v1[]
+AS 'MODULE_PATHNAME', 'uuid_v1_set_to_array'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE CAST (uuid_v1_set AS uuid_v1[]) WITH FUNCTION uuid_v1_set_to_array(uuid_v1_set) AS ASSIGNMENT;
+CREATE CAST (uuid_v1[] AS uuid_v1_set) WITH FUNCTION uuid_v1_sort_unique(uuid_v1[]) AS ASSIGNMENT;
+
+CREATE FUNCTION uuid_v1_set_support(internal)
+RETURNS internal
+AS 'MODULE_PATHNAME', 'uuid_v1_set_support'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_set_support(internal) IS 'planner support for set membership';
+
+CREATE FUNCTION uuid_v1_in_set(uuid_v1, uuid_v1_set)
+RETURNS bool
+AS 'MODULE_PATHNAME', 'uuid_v1_in_set'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+SUPPORT uuid_v1_set_support;
+
+COMMENT ON FUNCTION uuid_v1_in_set(uuid_v1, uuid_v1_set) IS 'is contained by';
+
+CREATE FUNCTION uuid_v1_set_contains(uuid_v1_set, uuid_v1)
+RETURNS bool
+AS 'MODULE_PATHNAME', 'uuid_v1_set_contains'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+SUPPORT uuid_v1_set_support;
+
+COMMENT ON FUNCTION uuid_v1_set_contains(uuid_v1_set, uuid_v1) IS 'contains';
+
+CREATE OPERATOR <@ (
+    LEFTARG = uuid_v1,
+    RIGHTARG = uuid_v1_set,
+    PROCEDURE = uuid_v1_in_set,
+    COMMUTATOR = '@>',
+    RESTRICT = contsel,
+    JOIN = contjoinsel
+);
+
+CREATE OPERATOR @> (
+    LEFTARG = uuid_v1_set,
+    RIGHTARG = uuid_v1,
+    PROCEDURE = uuid_v1_set_contains,
+    COMMUTATOR = '<@',
+    RESTRICT = contsel,
+    JOIN = contjoinsel
+);
+
+
+-- bloom filter for membership tests, binary compatible to bytea
+CREATE TYPE uuid_v1_bloom;
+
+CREATE FUNCTION uuid_v1_bloom_in(cstring)
+RETURNS uuid_v1_bloom
+AS 'MODULE_PATHNAME', 'uuid_v1_bloom_in'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_bloom_out(uuid_v1_bloom)
+RETURNS cstring
+AS 'MODULE_PATHNAME', 'uuid_v1_bloom_out'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_bloom_recv(internal)
+RETURNS uuid_v1_bloom
+AS 'MODULE_PATHNAME', 'uuid_v1_bloom_recv'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_bloom_send(uuid_v1_bloom)
+RETURNS bytea
+AS 'MODULE_PATHNAME', 'uuid_v1_bloom_send'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE TYPE uuid_v1_bloom (
+    INTERNALLENGTH = VARIABLE,
+    INPUT = uuid_v1_bloom_in,
+    OUTPUT = uuid_v1_bloom_out,
+    RECEIVE = uuid_v1_bloom_recv,
+    SEND = uuid_v1_bloom_send,
+    STORAGE = extended
+);
+
+CREATE FUNCTION uuid_v1_bloom(bytea)
+RETURNS uuid_v1_bloom
+AS 'MODULE_PATHNAME', 'uuid_v1_bloom_from_bytea'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_bloom(bytea) IS 'validate and convert bytea to bloom filter';
+
+CREATE CAST (uuid_v1_bloom AS bytea) WITHOUT FUNCTION AS ASSIGNMENT;
+CREATE CAST (bytea AS uuid_v1_bloom) WITH FUNCTION uuid_v1_bloom(bytea) AS ASSIGNMENT;
+
+CREATE FUNCTION uuid_v1_bloom_contains(uuid_v1_bloom, uuid_v1)
+RETURNS bool
+AS 'MODULE_PATHNAME', 'uuid_v1_bloom_contains'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_bloom_contains(uuid_v1_bloom, uuid_v1) IS 'may contain';
+
+CREATE FUNCTION uuid_v1_bloom_contained(uuid_v1, uuid_v1_bloom)
+RETURNS bool
+AS 'MODULE_PATHNAME', 'uuid_v1_bloom_contained'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_bloom_contained(uuid_v1, uuid_v1_bloom) IS 'may be contained by';
+
+CREATE OPERATOR @> (
+    LEFTARG = uuid_v1_bloom,
+    RIGHTARG = uuid_v1,
+    PROCEDURE = uuid_v1_bloom_contains,
+    COMMUTATOR = '<@',
+    RESTRICT = contsel,
+    JOIN = contjoinsel
+);
+
+CREATE OPERATOR <@ (
+    LEFTARG = uuid_v1,
+    RIGHTARG = uuid_v1_bloom,
+    PROCEDURE = uuid_v1_bloom_contained,
+    COMMUTATOR = '@>',
+    RESTRICT = contsel,
+    JOIN = contjoinsel
+);
+
+CREATE FUNCTION uuid_v1_bloom_agg_transfn(internal, uuid_v1, bigint, float8)
+RETURNS internal
+AS 'MODULE_PATHNAME', 'uuid_v1_bloom_agg_transfn'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_bloom_agg_combinefn(internal, internal)
+RETURNS internal
+AS 'MODULE_PATHNAME', 'uuid_v1_bloom_agg_combinefn'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_bloom_agg_finalfn(internal)
+RETURNS uuid_v1_bloom
+AS 'MODULE_PATHNAME', 'uuid_v1_flat_agg_finalfn'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_bloom_agg_serialfn(internal)
+RETURNS bytea
+AS 'MODULE_PATHNAME', 'uuid_v1_flat_agg_serialfn'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_bloom_agg_deserialfn(bytea, internal)
+RETURNS internal
+AS 'MODULE_PATHNAME', 'uuid_v1_bloom_agg_deserialfn'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE AGGREGATE uuid_v1_bloom_agg(uuid_v1, expected_n bigint, fpr float8) (
+    SFUNC = uuid_v1_bloom_agg_transfn,
+    STYPE = internal,
+    FINALFUNC = uuid_v1_bloom_agg_finalfn,
+    COMBINEFUNC = uuid_v1_bloom_agg_combinefn,
+    SERIALFUNC = uuid_v1_bloom_agg_serialfn,
+    DESERIALFUNC = uuid_v1_bloom_agg_deserialfn,
+    PARALLEL = SAFE
+);
+
+COMMENT ON AGGREGATE uuid_v1_bloom_agg(uuid_v1, bigint, float8) IS 'bloom filter of the input UUID''s';
+
+CREATE FUNCTION uuid_v1_bloom_agg_transfn(internal, uuid_v1, bigint, float8, bigint)
+RETURNS internal
+AS 'MODULE_PATHNAME', 'uuid_v1_bloom_agg_transfn'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE AGGREGATE uuid_v1_bloom_agg(uuid_v1, expected_n bigint, fpr float8, seed bigint) (
+    SFUNC = uuid_v1_bloom_agg_transfn,
+    STYPE = internal,
+    FINALFUNC = uuid_v1_bloom_agg_finalfn,
+    COMBINEFUNC = uuid_v1_bloom_agg_combinefn,
+    SERIALFUNC = uuid_v1_bloom_agg_serialfn,
+    DESERIALFUNC = uuid_v1_bloom_agg_deserialfn,
+    PARALLEL = SAFE
+);
+
+COMMENT ON AGGREGATE uuid_v1_bloom_agg(uuid_v1, bigint, float8, bigint) IS 'bloom filter of the input UUID''s, hashed with the given seed';
+
+
+-- time buckets, with sorted grouping on uuid_v1_ops indexes
+CREATE FUNCTION uuid_v1_time_bucket_support(internal)
+RETURNS internal
+AS 'MODULE_PATHNAME', 'uuid_v1_time_bucket_support'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_time_bucket_support(internal) IS 'planner support for uuid_v1_time_bucket';
+
+CREATE FUNCTION uuid_v1_time_bucket(bucket_width interval, id uuid_v1)
+RETURNS timestamp with time zone
+AS 'MODULE_PATHNAME', 'uuid_v1_time_bucket'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+SUPPORT uuid_v1_time_bucket_support;
+
+COMMENT ON FUNCTION uuid_v1_time_bucket(interval, uuid_v1) IS 'start of the time bucket of the UUID';
+
+CREATE FUNCTION uuid_v1_time_bucket(bucket_width interval, id uuid_v1, origin timestamp with time zone)
+RETURNS timestamp with time zone
+AS 'MODULE_PATHNAME', 'uuid_v1_time_bucket'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+SUPPORT uuid_v1_time_bucket_support;
+
+COMMENT ON FUNCTION uuid_v1_time_bucket(interval, uuid_v1, timestamp with time zone) IS 'start of the time bucket of the UUID';
+
+CREATE FUNCTION uuid_v1_time_bucket_lower(bucket_width interval, id uuid_v1)
+RETURNS uuid_v1
+AS 'MODULE_PATHNAME', 'uuid_v1_time_bucket_lower'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+SUPPORT uuid_v1_time_bucket_support;
+
+COMMENT ON FUNCTION uuid_v1_time_bucket_lower(interval, uuid_v1) IS 'smallest UUID of the time bucket of the UUID';
+
+CREATE FUNCTION uuid_v1_time_bucket_lower(bucket_width interval, id uuid_v1, origin timestamp with time zone)
+RETURNS uuid_v1
+AS 'MODULE_PATHNAME', 'uuid_v1_time_bucket_lower'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+SUPPORT uuid_v1_time_bucket_support;
+
+COMMENT ON FUNCTION uuid_v1_time_bucket_lower(interval, uuid_v1, timestamp with time zone) IS 'smallest UUID of the time bucket of the UUID';
+
+
+-- batched retention purge
+CREATE PROCEDURE uuid_v1_purge_before(
+    relation regclass,
+    cutoff timestamp with time zone,
+    batch_size integer DEFAULT 10000,
+    max_rate float8 DEFAULT 0
+)
+AS 'MODULE_PATHNAME', 'uuid_v1_purge_before'
+LANGUAGE C;
+
+COMMENT ON PROCEDURE uuid_v1_purge_before(regclass, timestamp with time zone, integer, float8) IS 'delete rows with a primary key older than the cutoff in batches';
+
+
+-- time map scans (requires shared_preload_libraries)
+CREATE FUNCTION uuid_v1_time_map_summarize(
+    relation regclass,
+    column_name name
+)
+RETURNS bigint
+AS 'MODULE_PATHNAME', 'uuid_v1_time_map_summarize'
+LANGUAGE C STRICT VOLATILE;
+
+COMMENT ON FUNCTION uuid_v1_time_map_summarize(regclass, name) IS 'summarize the all-visible block ranges of a table in the time map';
+
+
+-- hyperloglog sketches for approximate distinct counts, binary compatible to bytea
+CREATE TYPE uuid_v1_hll;
+
+CREATE FUNCTION uuid_v1_hll_in(cstring)
+RETURNS uuid_v1_hll
+AS 'MODULE_PATHNAME', 'uuid_v1_hll_in'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_hll_out(uuid_v1_hll)
+RETURNS cstring
+AS 'MODULE_PATHNAME', 'uuid_v1_hll_out'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_hll_recv(internal)
+RETURNS uuid_v1_hll
+AS 'MODULE_PATHNAME', 'uuid_v1_hll_recv'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_hll_send(uuid_v1_hll)
+RETURNS bytea
+AS 'MODULE_PATHNAME', 'uuid_v1_hll_send'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE TYPE uuid_v1_hll (
+    INTERNALLENGTH = VARIABLE,
+    INPUT = uuid_v1_hll_in,
+    OUTPUT = uuid_v1_hll_out,
+    RECEIVE = uuid_v1_hll_recv,
+    SEND = uuid_v1_hll_send,
+    STORAGE = extended
+);
+
+CREATE FUNCTION uuid_v1_hll(bytea)
+RETURNS uuid_v1_hll
+AS 'MODULE_PATHNAME', 'uuid_v1_hll_from_bytea'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_hll(bytea) IS 'validate and convert bytea to hll sketch';
+
+CREATE CAST (uuid_v1_hll AS bytea) WITHOUT FUNCTION AS ASSIGNMENT;
+CREATE CAST (bytea AS uuid_v1_hll) WITH FUNCTION uuid_v1_hll(bytea) AS ASSIGNMENT;
+
+CREATE FUNCTION uuid_v1_hll_cardinality(uuid_v1_hll)
+RETURNS bigint
+AS 'MODULE_PATHNAME', 'uuid_v1_hll_cardinality'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_hll_cardinality(uuid_v1_hll) IS 'estimated number of distinct values in the sketch';
+
+CREATE FUNCTION uuid_v1_hll_union(uuid_v1_hll, uuid_v1_hll)
+RETURNS uuid_v1_hll
+AS 'MODULE_PATHNAME', 'uuid_v1_hll_union'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_hll_union(uuid_v1_hll, uuid_v1_hll) IS 'union of two hll sketches';
+
+CREATE FUNCTION uuid_v1_hll_add_transfn(internal, uuid_v1)
+RETURNS internal
+AS 'MODULE_PATHNAME', 'uuid_v1_hll_add_transfn'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_hll_node_transfn(internal, uuid_v1)
+RETURNS internal
+AS 'MODULE_PATHNAME', 'uuid_v1_hll_node_transfn'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_hll_union_transfn(internal, uuid_v1_hll)
+RETURNS internal
+AS 'MODULE_PATHNAME', 'uuid_v1_hll_union_transfn'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_hll_combinefn(internal, internal)
+RETURNS internal
+AS 'MODULE_PATHNAME', 'uuid_v1_hll_combinefn'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_hll_finalfn(internal)
+RETURNS uuid_v1_hll
+AS 'MODULE_PATHNAME', 'uuid_v1_flat_agg_finalfn'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_hll_count_finalfn(internal)
+RETURNS bigint
+AS 'MODULE_PATHNAME', 'uuid_v1_hll_count_finalfn'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_hll_serialfn(internal)
+RETURNS bytea
+AS 'MODULE_PATHNAME', 'uuid_v1_flat_agg_serialfn'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_hll_deserialfn(bytea, internal)
+RETURNS internal
+AS 'MODULE_PATHNAME', 'uuid_v1_hll_deserialfn'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE AGGREGATE uuid_v1_approx_count_distinct(uuid_v1) (
+    SFUNC = uuid_v1_hll_add_transfn,
+    STYPE = internal,
+    FINALFUNC = uuid_v1_hll_count_finalfn,
+    COMBINEFUNC = uuid_v1_hll_combinefn,
+    SERIALFUNC = uuid_v1_hll_serialfn,
+    DESERIALFUNC = uuid_v1_hll_deserialfn,
+    PARALLEL = SAFE
+);
+
+COMMENT ON AGGREGATE uuid_v1_approx_count_distinct(uuid_v1) IS 'estimated number of distinct UUID''s';
+
+CREATE AGGREGATE uuid_v1_approx_distinct_nodes(uuid_v1) (
+    SFUNC = uuid_v1_hll_node_transfn,
+    STYPE = internal,
+    FINALFUNC = uuid_v1_hll_count_finalfn,
+    COMBINEFUNC = uuid_v1_hll_combinefn,
+    SERIALFUNC = uuid_v1_hll_serialfn,
+    DESERIALFUNC = uuid_v1_hll_deserialfn,
+    PARALLEL = SAFE
+);
+
+COMMENT ON AGGREGATE uuid_v1_approx_distinct_nodes(uuid_v1) IS 'estimated number of distinct nodes of the UUID''s';
+
+CREATE AGGREGATE uuid_v1_hll_agg(uuid_v1) (
+    SFUNC = uuid_v1_hll_add_transfn,
+    STYPE = internal,
+    FINALFUNC = uuid_v1_hll_finalfn,
+    COMBINEFUNC = uuid_v1_hll_combinefn,
+    SERIALFUNC = uuid_v1_hll_serialfn,
+    DESERIALFUNC = uuid_v1_hll_deserialfn,
+    PARALLEL = SAFE
+);
+
+COMMENT ON AGGREGATE uuid_v1_hll_agg(uuid_v1) IS 'hll sketch of the input UUID''s';
+
+CREATE AGGREGATE uuid_v1_hll_nodes_agg(uuid_v1) (
+    SFUNC = uuid_v1_hll_node_transfn,
+    STYPE = internal,
+    FINALFUNC = uuid_v1_hll_finalfn,
+    COMBINEFUNC = uuid_v1_hll_combinefn,
+    SERIALFUNC = uuid_v1_hll_serialfn,
+    DESERIALFUNC = uuid_v1_hll_deserialfn,
+    PARALLEL = SAFE
+);
+
+COMMENT ON AGGREGATE uuid_v1_hll_nodes_agg(uuid_v1) IS 'hll sketch of the nodes of the input UUID''s';
+
+CREATE AGGREGATE uuid_v1_hll_union_agg(uuid_v1_hll) (
+    SFUNC = uuid_v1_hll_union_transfn,
+    STYPE = internal,
+    FINALFUNC = uuid_v1_hll_finalfn,
+    COMBINEFUNC = uuid_v1_hll_combinefn,
+    SERIALFUNC = uuid_v1_hll_serialfn,
+    DESERIALFUNC = uuid_v1_hll_deserialfn,
+    PARALLEL = SAFE
+);
+
+COMMENT ON AGGREGATE uuid_v1_hll_union_agg(uuid_v1_hll) IS 'union of hll sketches';
+
+
+-- physical order quality report of tables and indexes
+CREATE FUNCTION uuid_v1_order_quality(
+    relation regclass,
+    exact boolean DEFAULT false,
+    OUT node bytea,
+    OUT pages bigint,
+    OUT rows bigint,
+    OUT out_of_order bigint,
+    OUT out_of_order_fraction float8,
+    OUT max_lateness interval,
+    OUT correlation float8,
+    OUT leaf_fill float8,
+    OUT cluster_gain float8
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME', 'uuid_v1_order_quality'
+LANGUAGE C STRICT VOLATILE;
+
+COMMENT ON FUNCTION uuid_v1_order_quality(regclass, boolean) IS 'report on the physical order of a table or index by UUID timestamp';
+
+
+-- btree operator class uuid_v1_node_ops, ordering by node, then timestamp
+CREATE FUNCTION uuid_v1_node_lt(uuid_v1, uuid_v1)
+RETURNS bool
+AS 'MODULE_PATHNAME', 'uuid_v1_node_lt'
+LANGUAGE C IMMUTABLE LEAKPROOF STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_node_lt(uuid_v1, uuid_v1) IS 'lower than in node order';
+
+CREATE OPERATOR <# (
+    LEFTARG = uuid_v1,
+    RIGHTARG = uuid_v1,
+    PROCEDURE = uuid_v1_node_lt,
+    COMMUTATOR = '>#',
+    NEGATOR = '>=#',
+    RESTRICT = scalarltsel,
+    JOIN = scalarltjoinsel
+);
+
+CREATE FUNCTION uuid_v1_node_le(uuid_v1, uuid_v1)
+RETURNS bool
+AS 'MODULE_PATHNAME', 'uuid_v1_node_le'
+LANGUAGE C IMMUTABLE LEAKPROOF STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_node_le(uuid_v1, uuid_v1) IS 'lower than or equal to in node order';
+
+CREATE OPERATOR <=# (
+    LEFTARG = uuid_v1,
+    RIGHTARG = uuid_v1,
+    PROCEDURE = uuid_v1_node_le,
+    COMMUTATOR = '>=#',
+    NEGATOR = '>#',
+    RESTRICT = scalarltsel,
+    JOIN = scalarltjoinsel
+);
+
+CREATE FUNCTION uuid_v1_node_gt(uuid_v1, uuid_v1)
+RETURNS bool
+AS 'MODULE_PATHNAME', 'uuid_v1_node_gt'
+LANGUAGE C IMMUTABLE LEAKPROOF STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_node_gt(uuid_v1, uuid_v1) IS 'greater than in node order';
+
+CREATE OPERATOR ># (
+    LEFTARG = uuid_v1,
+    RIGHTARG = uuid_v1,
+    PROCEDURE = uuid_v1_node_gt,
+    COMMUTATOR = '<#',
+    NEGATOR = '<=#',
+    RESTRICT = scalargtsel,
+    JOIN = scalargtjoinsel
+);
+
+CREATE FUNCTION uuid_v1_node_ge(uuid_v1, uuid_v1)
+RETURNS bool
+AS 'MODULE_PATHNAME', 'uuid_v1_node_ge'
+LANGUAGE C IMMUTABLE LEAKPROOF STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_node_ge(uuid_v1, uuid_v1) IS 'greater than or equal to in node order';
+
+CREATE OPERATOR >=# (
+    LEFTARG = uuid_v1,
+    RIGHTARG = uuid_v1,
+    PROCEDURE = uuid_v1_node_ge,
+    COMMUTATOR = '<=#',
+    NEGATOR = '<#',
+    RESTRICT = scalargtsel,
+    JOIN = scalargtjoinsel
+);
+
+CREATE FUNCTION uuid_v1_node_support(internal)
+RETURNS internal
+AS 'MODULE_PATHNAME', 'uuid_v1_node_support'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_node_support(internal) IS 'planner support for comparisons of the node';
+
+CREATE FUNCTION uuid_v1_node_eq_bytea(uuid_v1, bytea)
+RETURNS bool
+AS 'MODULE_PATHNAME', 'uuid_v1_node_eq_bytea'
+LANGUAGE C IMMUTABLE LEAKPROOF STRICT PARALLEL SAFE
+SUPPORT uuid_v1_node_support;
+
+COMMENT ON FUNCTION uuid_v1_node_eq_bytea(uuid_v1, bytea) IS 'node equal to';
+
+CREATE OPERATOR =# (
+    LEFTARG = uuid_v1,
+    RIGHTARG = bytea,
+    PROCEDURE = uuid_v1_node_eq_bytea,
+    RESTRICT = eqsel,
+    JOIN = eqjoinsel
+);
+
+CREATE FUNCTION uuid_v1_node_lt_bytea(uuid_v1, bytea)
+RETURNS bool
+AS 'MODULE_PATHNAME', 'uuid_v1_node_lt_bytea'
+LANGUAGE C IMMUTABLE LEAKPROOF STRICT PARALLEL SAFE
+SUPPORT uuid_v1_node_support;
+
+COMMENT ON FUNCTION uuid_v1_node_lt_bytea(uuid_v1, bytea) IS 'node lower than';
+
+CREATE OPERATOR <# (
+    LEFTARG = uuid_v1,
+    RIGHTARG = bytea,
+    PROCEDURE = uuid_v1_node_lt_bytea,
+    NEGATOR = '>=#',
+    RESTRICT = scalarltsel,
+    JOIN = scalarltjoinsel
+);
+
+CREATE FUNCTION uuid_v1_node_le_bytea(uuid_v1, bytea)
+RETURNS bool
+AS 'MODULE_PATHNAME', 'uuid_v1_node_le_bytea'
+LANGUAGE C IMMUTABLE LEAKPROOF STRICT PARALLEL SAFE
+SUPPORT uuid_v1_node_support;
+
+COMMENT ON FUNCTION uuid_v1_node_le_bytea(uuid_v1, bytea) IS 'node lower than or equal to';
+
+CREATE OPERATOR <=# (
+    LEFTARG = uuid_v1,
+    RIGHTARG = bytea,
+    PROCEDURE = uuid_v1_node_le_bytea,
+    NEGATOR = '>#',
+    RESTRICT = scalarltsel,
+    JOIN = scalarltjoinsel
+);
+
+CREATE FUNCTION uuid_v1_node_gt_bytea(uuid_v1, bytea)
+RETURNS bool
+AS 'MODULE_PATHNAME', 'uuid_v1_node_gt_bytea'
+LANGUAGE C IMMUTABLE LEAKPROOF STRICT PARALLEL SAFE
+SUPPORT uuid_v1_node_support;
+
+COMMENT ON FUNCTION uuid_v1_node_gt_bytea(uuid_v1, bytea) IS 'node greater than';
+
+CREATE OPERATOR ># (
+    LEFTARG = uuid_v1,
+    RIGHTARG = bytea,
+    PROCEDURE = uuid_v1_node_gt_bytea,
+    NEGATOR = '<=#',
+    RESTRICT = scalargtsel,
+    JOIN = scalargtjoinsel
+);
+
+CREATE FUNCTION uuid_v1_node_ge_bytea(uuid_v1, bytea)
+RETURNS bool
+AS 'MODULE_PATHNAME', 'uuid_v1_node_ge_bytea'
+LANGUAGE C IMMUTABLE LEAKPROOF STRICT PARALLEL SAFE
+SUPPORT uuid_v1_node_support;
+
+COMMENT ON FUNCTION uuid_v1_node_ge_bytea(uuid_v1, bytea) IS 'node greater than or equal to';
+
+CREATE OPERATOR >=# (
+    LEFTARG = uuid_v1,
+    RIGHTARG = bytea,
+    PROCEDURE = uuid_v1_node_ge_bytea,
+    NEGATOR = '<#',
+    RESTRICT = scalargtsel,
+    JOIN = scalargtjoinsel
+);
+
+CREATE FUNCTION uuid_v1_node_cmp(uuid_v1, uuid_v1)
+RETURNS int4
+AS 'MODULE_PATHNAME', 'uuid_v1_node_cmp'
+LANGUAGE C IMMUTABLE LEAKPROOF STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_node_cmp(uuid_v1, uuid_v1) IS 'UUID v1 comparison function in node order';
+
+CREATE FUNCTION uuid_v1_node_sortsupport(internal)
+RETURNS void
+AS 'MODULE_PATHNAME', 'uuid_v1_node_sortsupport'
+LANGUAGE C IMMUTABLE LEAKPROOF STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_node_sortsupport(internal) IS 'btree sort support function in node order';
+
+CREATE FUNCTION uuid_v1_node_lower(node bytea, ts timestamp with time zone)
+RETURNS uuid_v1
+AS 'MODULE_PATHNAME', 'uuid_v1_node_lower'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_node_lower(bytea, timestamp with time zone) IS 'smallest UUID of the node at the timestamp';
+
+CREATE OPERATOR CLASS uuid_v1_node_ops FOR TYPE uuid_v1
+    USING btree AS
+        OPERATOR        1       <#,
+        OPERATOR        2       <=#,
+        OPERATOR        3       =,
+        OPERATOR        4       >=#,
+        OPERATOR        5       >#,
+        FUNCTION        1       uuid_v1_node_cmp(uuid_v1, uuid_v1),
+        FUNCTION        2       uuid_v1_node_sortsupport(internal)
+;
+
+
+-- statistics of the time gaps between consecutive UUID's of each node
+CREATE TYPE uuid_v1_gap_summary AS (
+    gaps bigint,
+    out_of_order bigint,
+    p50 interval,
+    p99 interval,
+    max interval
+);
+
+CREATE FUNCTION uuid_v1_gap_stats_transfn(internal, uuid_v1)
+RETURNS internal
+AS 'MODULE_PATHNAME', 'uuid_v1_gap_stats_transfn'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_gap_stats_combinefn(internal, internal)
+RETURNS internal
+AS 'MODULE_PATHNAME', 'uuid_v1_gap_stats_combinefn'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_gap_stats_finalfn(internal)
+RETURNS uuid_v1_gap_summary
+AS 'MODULE_PATHNAME', 'uuid_v1_gap_stats_finalfn'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_gap_stats_serialfn(internal)
+RETURNS bytea
+AS 'MODULE_PATHNAME', 'uuid_v1_gap_stats_serialfn'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION uuid_v1_gap_stats_deserialfn(bytea, internal)
+RETURNS internal
+AS 'MODULE_PATHNAME', 'uuid_v1_gap_stats_deserialfn'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE AGGREGATE uuid_v1_gap_stats(uuid_v1) (
+    SFUNC = uuid_v1_gap_stats_transfn,
+    STYPE = internal,
+    FINALFUNC = uuid_v1_gap_stats_finalfn,
+    FINALFUNC_MODIFY = READ_WRITE,
+    COMBINEFUNC = uuid_v1_gap_stats_combinefn,
+    SERIALFUNC = uuid_v1_gap_stats_serialfn,
+    DESERIALFUNC = uuid_v1_gap_stats_deserialfn,
+    PARALLEL = RESTRICTED
+);
+
+COMMENT ON AGGREGATE uuid_v1_gap_stats(uuid_v1) IS 'statistics of the time gaps between consecutive UUID''s of each node';
+
+
+-- bulk loader for files of binary UUID's
+CREATE FUNCTION uuid_v1_read_binary(
+    path text,
+    "offset" bigint DEFAULT 0,
+    count bigint DEFAULT NULL,
+    skip_invalid boolean DEFAULT false
+)
+RETURNS SETOF uuid_v1
+AS 'MODULE_PATHNAME', 'uuid_v1_read_binary'
+LANGUAGE C VOLATILE PARALLEL SAFE;
+
+COMMENT ON FUNCTION uuid_v1_read_binary(text, bigint, bigint, boolean) IS 'read UUID''s from a file of 16 byte binary values';
+
+REVOKE ALL ON FUNCTION uuid_v1_read_binary(text, bigint, bigint, boolean) FROM PUBLIC;
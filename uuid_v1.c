@@ -19,20 +19,27 @@
 #include "postgres.h"
 
 #include "access/hash.h"
+#include "access/tupmacs.h"
+#include "catalog/pg_type.h"
 #include "datatype/timestamp.h"
 #include "lib/stringinfo.h"
 #include "lib/hyperloglog.h"
 #include "libpq/pqformat.h"
 #include "port/pg_bswap.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/guc.h"
+#include "utils/lsyscache.h"
 #include "utils/sortsupport.h"
+#include "utils/syscache.h"
 #include "utils/timestamp.h"
 #include "utils/uuid.h"
 #include "uuid_v1.h"
 
 PG_MODULE_MAGIC;
 
+void _PG_init(void);
+
 #define PG_UUID_OFFSET_EPOCH INT64CONST(122192928000000000)
 
 /*
@@ -53,9 +60,25 @@ typedef struct
 	hyperLogLogState abbr_card; /* cardinality estimator */
 } uuid_v1_sortsupport_state;
 
+/* result codes of parse_uuid_v1_internal */
+#define UUID_V1_PARSE_OK		0
+#define UUID_V1_PARSE_SYNTAX	1
+#define UUID_V1_PARSE_VERSION	2
+#define UUID_V1_PARSE_VARIANT	3
+
+/* element conversion callback of uuid_v1_convert_array */
+typedef bool (*uuid_v1_array_converter) (const char *src, char *dst, bool skip_invalid);
+
+static int parse_uuid_v1_internal(const char *source, pg_uuid_v1 *uuid);
 static void parse_uuid_v1(const char *source, pg_uuid_v1 *uuid);
-static int64 to_uuid_timestamp(const TimestampTz ts);
-static int uuid_v1_cmp0(const pg_uuid_v1 *a, const pg_uuid_v1 *b);
+static bool uuid_std_to_v1_internal(const pg_uuid_t *uuid, pg_uuid_v1 *dst);
+static void uuid_v1_to_std_internal(const pg_uuid_v1 *uuid, pg_uuid_t *dst);
+
+static ArrayType* uuid_v1_convert_array(ArrayType *input, int16 typlen, char typalign,
+		Oid elemtype, bool skip_invalid, uuid_v1_array_converter convert);
+static bool uuid_v1_array_to_std(const char *src, char *dst, bool skip_invalid);
+static bool uuid_v1_array_from_text(const char *src, char *dst, bool skip_invalid);
+static Oid uuid_v1_result_elemtype(FunctionCallInfo fcinfo);
 static int uuid_v1_cmp_ts0(const pg_uuid_v1 *a, const TimestampTz b);
 
 static int uuid_v1_cmp_abbrev(Datum x, Datum y, SortSupport ssup);
@@ -69,6 +92,23 @@ static const unsigned char* uuid_node(const pg_uuid_t *uuid);
 
 static float8 uuid_v1_epoch_internal(const pg_uuid_v1 *uuid);
 
+/*
+ * Module load callback
+ */
+void
+_PG_init(void)
+{
+	uuid_v1_node_lag_init();
+	uuid_v1_time_bucket_init();
+	uuid_v1_time_map_init();
+
+#if PG_VERSION_NUM >= 150000
+	MarkGUCPrefixReserved("uuid_v1");
+#else
+	EmitWarningsOnPlaceholders("uuid_v1");
+#endif
+}
+
 PG_FUNCTION_INFO_V1(uuid_v1_in);
 PG_FUNCTION_INFO_V1(uuid_v1_out);
 PG_FUNCTION_INFO_V1(uuid_v1_recv);
@@ -81,6 +121,9 @@ PG_FUNCTION_INFO_V1(uuid_v1_clockseq);
 
 PG_FUNCTION_INFO_V1(uuid_v1_conv_from_std);
 PG_FUNCTION_INFO_V1(uuid_v1_conv_to_std);
+PG_FUNCTION_INFO_V1(uuid_v1_conv_from_std_array);
+PG_FUNCTION_INFO_V1(uuid_v1_conv_to_std_array);
+PG_FUNCTION_INFO_V1(uuid_v1_parse_array);
 
 PG_FUNCTION_INFO_V1(uuid_v1_sortsupport);
 
@@ -203,8 +246,13 @@ uuid_v1_out(PG_FUNCTION_ARGS)
 	PG_RETURN_CSTRING(str);
 }
 
-static void
-parse_uuid_v1(const char *source, pg_uuid_v1 *uuid)
+/*
+ * parse_uuid_v1_internal
+ *	Parse the string representation of a version 1 UUID without raising
+ *	errors, returns one of the UUID_V1_PARSE_* result codes.
+ */
+static int
+parse_uuid_v1_internal(const char *source, pg_uuid_v1 *uuid)
 {
 	int64 timestamp;
 	int16 clock_seq;
@@ -235,11 +283,11 @@ parse_uuid_v1(const char *source, pg_uuid_v1 *uuid)
 
 	/* no more input... */
 	if (!(*src) || i < 16)
-		goto syntax_error;
+		return UUID_V1_PARSE_SYNTAX;
 
 	/* version mismatch */
 	if ((timestamp & 0xF000) != 0x1000)
-		goto version_error;
+		return UUID_V1_PARSE_VERSION;
 
 	uuid->timestamp = (
 			((timestamp << 48) & 0x0FFF000000000000) |
@@ -247,7 +295,7 @@ parse_uuid_v1(const char *source, pg_uuid_v1 *uuid)
 			((timestamp >> 32) & 0x00000000FFFFFFFF));
 
 	if (uuid->timestamp < 0)
-		goto syntax_error;
+		return UUID_V1_PARSE_SYNTAX;
 
 	for (i = 0; i < 4 && *src;)
 	{
@@ -267,11 +315,11 @@ parse_uuid_v1(const char *source, pg_uuid_v1 *uuid)
 
 	/* no more input... */
 	if (!(*src) || i < 4)
-		goto syntax_error;
+		return UUID_V1_PARSE_SYNTAX;
 
 	/* variant mismatch */
 	if ((clock_seq & 0xC000) != 0x8000)
-		goto variant_error;
+		return UUID_V1_PARSE_VARIANT;
 
 	uuid->clock_seq = clock_seq & 0x3FFF;
 
@@ -297,29 +345,41 @@ parse_uuid_v1(const char *source, pg_uuid_v1 *uuid)
 
 	/* not enough input... */
 	if (i < 12)
-		goto syntax_error;
+		return UUID_V1_PARSE_SYNTAX;
 
 	memcpy(uuid->node, node, 6);
 
-	return;
-
-syntax_error:
-	ereport(ERROR,
-			(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
-			errmsg("invalid input syntax for type %s: \"%s\"",
-			"uuid_v1", source)));
-
-version_error:
-	ereport(ERROR,
-			(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
-			errmsg("invalid version for type %s: \"%s\"",
-			"uuid_v1", source)));
+	return UUID_V1_PARSE_OK;
+}
 
-variant_error:
-	ereport(ERROR,
-			(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
-			errmsg("invalid variant for type %s: \"%s\"",
-			"uuid_v1", source)));
+static void
+parse_uuid_v1(const char *source, pg_uuid_v1 *uuid)
+{
+	switch (parse_uuid_v1_internal(source, uuid))
+	{
+		case UUID_V1_PARSE_OK:
+			return;
+
+		case UUID_V1_PARSE_VERSION:
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+					errmsg("invalid version for type %s: \"%s\"",
+					"uuid_v1", source)));
+			break;
+
+		case UUID_V1_PARSE_VARIANT:
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+					errmsg("invalid variant for type %s: \"%s\"",
+					"uuid_v1", source)));
+			break;
+
+		default:
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+					errmsg("invalid input syntax for type %s: \"%s\"",
+					"uuid_v1", source)));
+	}
 }
 
 Datum
@@ -376,6 +436,232 @@ uuid_v1_conv_to_std(PG_FUNCTION_ARGS)
 	PG_RETURN_UUID_P(output);
 }
 
+/*
+ * uuid_v1_convert_array
+ *	Convert all elements of an array of UUID's in a single pass.
+ *
+ * The result is allocated once and filled in a tight loop using the given
+ * element conversion. Invalid elements are either dropped or raise an error,
+ * depending on skip_invalid. The dimensions of the input are kept, unless
+ * elements have been dropped, in which case a one-dimensional array is
+ * returned.
+ */
+static ArrayType*
+uuid_v1_convert_array(ArrayType *input, int16 typlen, char typalign,
+		Oid elemtype, bool skip_invalid, uuid_v1_array_converter convert)
+{
+	int ndim = ARR_NDIM(input);
+	int nitems = ArrayGetNItems(ndim, ARR_DIMS(input));
+	ArrayType *result;
+	Size reserved;
+	Size overhead;
+	char *src;
+	char *data;
+	bits8 *src_bitmap;
+	bits8 *nulls;
+	int bitmask = 1;
+	int nout = 0;
+	int ndata = 0;
+	bool hasnull = false;
+	int i;
+
+	if (nitems == 0)
+		return construct_empty_array(elemtype);
+
+	/*
+	 * Reserve room for the largest possible header, adjusted at the end. It
+	 * is zeroed, so the padding in front of the data is too.
+	 */
+	reserved = ARR_OVERHEAD_WITHNULLS(ndim, nitems);
+	result = (ArrayType *) palloc0(reserved + (Size) nitems * UUID_LEN);
+	nulls = (bits8 *) palloc0((nitems + 7) / 8);
+	data = (char *) result + reserved;
+
+	src = ARR_DATA_PTR(input);
+	src_bitmap = ARR_NULLBITMAP(input);
+
+	for (i = 0; i < nitems; i++)
+	{
+		if (src_bitmap && (*src_bitmap & bitmask) == 0)
+		{
+			hasnull = true;
+			nout++;
+		}
+		else
+		{
+			/* NULL's take no space in the data area */
+			if (convert(src, data + (Size) ndata * UUID_LEN, skip_invalid))
+			{
+				nulls[nout / 8] |= 1 << (nout % 8);
+				nout++;
+				ndata++;
+			}
+
+			src = att_addlength_pointer(src, typlen, src);
+			src = (char *) att_align_nominal(src, typalign);
+		}
+
+		if (src_bitmap)
+		{
+			bitmask <<= 1;
+			if (bitmask == 0x100)
+			{
+				src_bitmap++;
+				bitmask = 1;
+			}
+		}
+	}
+
+	if (nout == 0)
+		return construct_empty_array(elemtype);
+
+	if (nout < nitems)
+		ndim = 1;
+
+	overhead = hasnull ? ARR_OVERHEAD_WITHNULLS(ndim, nout) : ARR_OVERHEAD_NONULLS(ndim);
+
+	/* the final header is never larger than the reserved one */
+	memmove((char *) result + overhead, data, (Size) ndata * UUID_LEN);
+
+	SET_VARSIZE(result, overhead + (Size) ndata * UUID_LEN);
+	result->ndim = ndim;
+	result->dataoffset = hasnull ? (int32) overhead : 0;
+	result->elemtype = elemtype;
+
+	if (nout < nitems)
+	{
+		ARR_DIMS(result)[0] = nout;
+		ARR_LBOUND(result)[0] = 1;
+	}
+	else
+	{
+		memcpy(ARR_DIMS(result), ARR_DIMS(input), ndim * sizeof(int));
+		memcpy(ARR_LBOUND(result), ARR_LBOUND(input), ndim * sizeof(int));
+	}
+
+	/* the bitmap directly follows the lower bounds */
+	if (hasnull)
+		memcpy(ARR_LBOUND(result) + ndim, nulls, (nout + 7) / 8);
+
+	return result;
+}
+
+/*
+ * uuid_v1_array_from_std
+ *	Convert a standard UUID in binary form into a V1 UUID, returning false
+ *	for invalid ones if skip_invalid is set and raising an error otherwise.
+ */
+bool
+uuid_v1_array_from_std(const char *src, char *dst, bool skip_invalid)
+{
+	const pg_uuid_t *uuid = (const pg_uuid_t *) src;
+
+	if (uuid_std_to_v1_internal(uuid, (pg_uuid_v1 *) dst))
+		return true;
+
+	if (!skip_invalid)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				errmsg("invalid %s for type %s: \"%s\"",
+				1 != ((uuid->data[6] >> 4) & 0x0F) ? "version" : "variant", "uuid_v1",
+				DatumGetCString(DirectFunctionCall1(uuid_out, UUIDPGetDatum(uuid))))));
+
+	return false;
+}
+
+static bool
+uuid_v1_array_to_std(const char *src, char *dst, bool skip_invalid)
+{
+	uuid_v1_to_std_internal((const pg_uuid_v1 *) src, (pg_uuid_t *) dst);
+	return true;
+}
+
+static bool
+uuid_v1_array_from_text(const char *src, char *dst, bool skip_invalid)
+{
+	char buffer[64];
+	char *str = buffer;
+	int len = VARSIZE_ANY_EXHDR(src);
+
+	/* avoid an allocation for anything that could reasonably be a UUID */
+	if (len < sizeof(buffer))
+	{
+		memcpy(buffer, VARDATA_ANY(src), len);
+		buffer[len] = '\0';
+	}
+	else
+		str = text_to_cstring((const text *) src);
+
+	if (parse_uuid_v1_internal(str, (pg_uuid_v1 *) dst) == UUID_V1_PARSE_OK)
+		return true;
+
+	if (!skip_invalid)
+		parse_uuid_v1(str, (pg_uuid_v1 *) dst);
+
+	return false;
+}
+
+/*
+ * uuid_v1_result_elemtype
+ *	Element type of the array returned by the function being called.
+ */
+static Oid
+uuid_v1_result_elemtype(FunctionCallInfo fcinfo)
+{
+	Oid elemtype = get_element_type(get_fn_expr_rettype(fcinfo->flinfo));
+
+	if (!OidIsValid(elemtype))
+		elog(ERROR, "could not determine result element type");
+
+	return elemtype;
+}
+
+Datum
+uuid_v1_conv_from_std_array(PG_FUNCTION_ARGS)
+{
+	ArrayType *input = PG_GETARG_ARRAYTYPE_P(0);
+	bool skip_invalid = PG_GETARG_BOOL(1);
+
+	PG_RETURN_ARRAYTYPE_P(uuid_v1_convert_array(input, UUID_LEN, 'c',
+			uuid_v1_result_elemtype(fcinfo), skip_invalid, uuid_v1_array_from_std));
+}
+
+Datum
+uuid_v1_conv_to_std_array(PG_FUNCTION_ARGS)
+{
+	ArrayType *input = PG_GETARG_ARRAYTYPE_P(0);
+
+	PG_RETURN_ARRAYTYPE_P(uuid_v1_convert_array(input, UUID_LEN, 'd',
+			UUIDOID, false, uuid_v1_array_to_std));
+}
+
+Datum
+uuid_v1_parse_array(PG_FUNCTION_ARGS)
+{
+	ArrayType *input = PG_GETARG_ARRAYTYPE_P(0);
+	bool skip_invalid = PG_GETARG_BOOL(1);
+
+	PG_RETURN_ARRAYTYPE_P(uuid_v1_convert_array(input, -1, 'i',
+			uuid_v1_result_elemtype(fcinfo), skip_invalid, uuid_v1_array_from_text));
+}
+
+/*
+ * uuid_std_to_v1_internal
+ *	Convert a standard UUID into a V1 UUID in place, if possible.
+ */
+static bool
+uuid_std_to_v1_internal(const pg_uuid_t *uuid, pg_uuid_v1 *dst)
+{
+	if (1 != ((uuid->data[6] >> 4) & 0x0F) || (0x80 != ((uuid->data[8]) & 0xC0)))
+		return false;
+
+	dst->timestamp = uuid_timestamp_int(uuid);
+	dst->clock_seq = uuid_clockseq(uuid);
+	memcpy(dst->node, uuid_node(uuid), UUID_NODE_LEN);
+
+	return true;
+}
+
 /*
  * uuid_std_to_v1
  *	Convert a standard UUID into a V1 UUID, if possible.
@@ -385,28 +671,24 @@ uuid_std_to_v1(const pg_uuid_t *uuid)
 {
 	pg_uuid_v1 *uuid_v1;
 
-	if (1 != ((uuid->data[6] >> 4) & 0x0F) || (0x80 != ((uuid->data[8]) & 0xC0)))
-		return NULL;
-
 	uuid_v1 = (pg_uuid_v1 *) palloc(UUID_LEN);
-	uuid_v1->timestamp = uuid_timestamp_int(uuid);
-	uuid_v1->clock_seq = uuid_clockseq(uuid);
-	memcpy(uuid_v1->node, uuid_node(uuid), UUID_NODE_LEN);
+	if (!uuid_std_to_v1_internal(uuid, uuid_v1))
+	{
+		pfree(uuid_v1);
+		return NULL;
+	}
 
 	return uuid_v1;
 }
 
-pg_uuid_t*
-uuid_v1_to_std(const pg_uuid_v1 *uuid)
+static void
+uuid_v1_to_std_internal(const pg_uuid_v1 *uuid, pg_uuid_t *std)
 {
-	pg_uuid_t *std;
 	uint8 offset = 0;
 	uint8 size;
 	uint32 i;
 	uint16 s;
 
-	std = (pg_uuid_t *) palloc(UUID_LEN);
-
 	/* write time_low in network byte order */
 	i = pg_hton32((uint32) (uuid->timestamp & 0x00000000FFFFFFFF));
 	size = sizeof(uint32);
@@ -431,6 +713,15 @@ uuid_v1_to_std(const pg_uuid_v1 *uuid)
 
 	/* write node value as is */
 	memcpy(std->data + offset, uuid->node, UUID_NODE_LEN);
+}
+
+pg_uuid_t*
+uuid_v1_to_std(const pg_uuid_v1 *uuid)
+{
+	pg_uuid_t *std;
+
+	std = (pg_uuid_t *) palloc(UUID_LEN);
+	uuid_v1_to_std_internal(uuid, std);
 
 	return std;
 }
@@ -507,6 +798,26 @@ uuid_v1_timestamptz(const pg_uuid_v1 *uuid)
 	return timestamp;
 }
 
+/*
+ * uuid_v1_type_oid
+ *	Look up the OID of type uuid_v1, which lives in the same schema as the
+ *	given function of this extension.
+ */
+Oid
+uuid_v1_type_oid(Oid fn_oid)
+{
+	Oid typoid;
+
+	typoid = GetSysCacheOid2(TYPENAMENSP, Anum_pg_type_oid,
+							 CStringGetDatum("uuid_v1"),
+							 ObjectIdGetDatum(get_func_namespace(fn_oid)));
+
+	if (!OidIsValid(typoid))
+		elog(ERROR, "could not find type uuid_v1");
+
+	return typoid;
+}
+
 /*
  * uuid_v1_timestamp
  *	extract the timestamp of a version 1 UUID
@@ -569,7 +880,11 @@ uuid_v1_node(PG_FUNCTION_ARGS)
 	PG_RETURN_BYTEA_P(bytes);
 }
 
-static int
+/*
+ * uuid_v1_cmp0
+ *	Compare by timestamp, then clock sequence, then node.
+ */
+int
 uuid_v1_cmp0(const pg_uuid_v1 *a, const pg_uuid_v1 *b)
 {
 	int64 diff = a->timestamp - b->timestamp;
@@ -655,12 +970,24 @@ uuid_v1_ge(PG_FUNCTION_ARGS)
  *	Convert a given timestamp into a UUID timestamp value.
  *
  */
-static int64
+int64
 to_uuid_timestamp(const TimestampTz ts)
 {
 	return (((int64) ts) + PG_UUID_OFFSET) * 10;
 }
 
+/*
+ * uuid_timestamp_in_range
+ *	Check whether a timestamp fits into the 60 bits of a UUID timestamp, so
+ *	that to_uuid_timestamp() can't overflow.
+ */
+bool
+uuid_timestamp_in_range(const TimestampTz ts)
+{
+	return ts >= -PG_UUID_OFFSET &&
+		ts <= ((INT64CONST(1) << 60) - 1) / 10 - PG_UUID_OFFSET;
+}
+
 static int
 uuid_v1_cmp_ts0(const pg_uuid_v1 *a, const TimestampTz b)
 {
@@ -758,29 +1085,67 @@ uuid_v1_sortsupport(PG_FUNCTION_ARGS)
 
 	if (ssup->abbreviate)
 	{
-		uuid_v1_sortsupport_state *uss;
-		MemoryContext oldcontext;
+		uuid_v1_abbrev_init(ssup);
 
-		oldcontext = MemoryContextSwitchTo(ssup->ssup_cxt);
-
-		uss = palloc(sizeof(uuid_v1_sortsupport_state));
-		uss->input_count = 0;
-		uss->estimating = true;
-		initHyperLogLog(&uss->abbr_card, 10);
-
-		ssup->ssup_extra = uss;
-
-		ssup->comparator = uuid_v1_cmp_abbrev;
 		ssup->abbrev_converter = uuid_v1_abbrev_convert;
-		ssup->abbrev_abort = uuid_v1_abbrev_abort;
 		ssup->abbrev_full_comparator = uuid_v1_sort_cmp;
-
-		MemoryContextSwitchTo(oldcontext);
 	}
 
 	PG_RETURN_VOID();
 }
 
+/*
+ * uuid_v1_abbrev_init
+ *	Set up the state, comparator and abort callback of abbreviated keys,
+ *	which are compared as unsigned integers. The caller provides the
+ *	conversion and the full comparator.
+ */
+void
+uuid_v1_abbrev_init(SortSupport ssup)
+{
+	uuid_v1_sortsupport_state *uss;
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(ssup->ssup_cxt);
+
+	uss = palloc(sizeof(uuid_v1_sortsupport_state));
+	uss->input_count = 0;
+	uss->estimating = true;
+	initHyperLogLog(&uss->abbr_card, 10);
+
+	ssup->ssup_extra = uss;
+
+	ssup->comparator = uuid_v1_cmp_abbrev;
+	ssup->abbrev_abort = uuid_v1_abbrev_abort;
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * uuid_v1_abbrev_count
+ *	Account for an abbreviated key in the cardinality estimate.
+ */
+void
+uuid_v1_abbrev_count(SortSupport ssup, Datum abbrev)
+{
+	uuid_v1_sortsupport_state *uss = ssup->ssup_extra;
+
+	uss->input_count += 1;
+
+	if (uss->estimating)
+	{
+		uint32 tmp;
+
+#if SIZEOF_DATUM == 8
+		tmp = (uint32) abbrev ^ (uint32) ((uint64) abbrev >> 32);
+#else       /* SIZEOF_DATUM != 8 */
+		tmp = (uint32) abbrev;
+#endif
+
+		addHyperLogLog(&uss->abbr_card, DatumGetUInt32(hash_uint32(tmp)));
+	}
+}
+
 /*
  * SortSupport comparison func
  */
@@ -798,50 +1163,24 @@ uuid_v1_sort_cmp(Datum x, Datum y, SortSupport ssup)
  *
  * Converts original uuid representation to abbreviated key representation.
  *
- * Our encoding strategy is simple: if the UUID is an RFC 4122 version 1 then
- * extract the 60-bit timestamp. Otherwise, pack the first `sizeof(Datum)`
- * bytes of uuid data into a Datum (on little-endian machines, the bytes are
- * stored in reverse order), and treat it as an unsigned integer.
+ * The key is the 60 bit timestamp, which is never negative and so compares
+ * correctly as an unsigned integer. With 4 byte Datums, only its upper 32
+ * bits are kept.
  */
 static Datum
 uuid_v1_abbrev_convert(Datum original, SortSupport ssup)
 {
-	uuid_v1_sortsupport_state *uss = ssup->ssup_extra;
 	pg_uuid_v1 *authoritative = DatumGetUUIDV1P(original);
 	Datum res;
 	int64 timestamp = authoritative->timestamp;
 
 #if SIZEOF_DATUM == 8
-	memcpy(&res, &timestamp, sizeof(Datum));
-#else       /* SIZEOF_DATUM != 8 */
-	/* use last 4 bytes of int64 as they are more significant */
-	memcpy(&res, &timestamp + 4, sizeof(Datum));
-#endif
-
-	uss->input_count += 1;
-
-	if (uss->estimating)
-	{
-		uint32 tmp;
-
-#if SIZEOF_DATUM == 8
-		tmp = (uint32) res ^ (uint32) ((uint64) res >> 32);
+	res = (Datum) timestamp;
 #else       /* SIZEOF_DATUM != 8 */
-		tmp = (uint32) res;
+	res = (Datum) (timestamp >> 28);
 #endif
 
-		addHyperLogLog(&uss->abbr_card, DatumGetUInt32(hash_uint32(tmp)));
-	}
-
-	/*
-	 * Byteswap on little-endian machines.
-	 *
-	 * This is needed so that uuid_ts_cmp_abbrev() (an unsigned integer 3-way
-	 * comparator) works correctly on all platforms.  If we didn't do this,
-	 * the comparator would have to call memcmp() with a pair of pointers to
-	 * the first byte of each abbreviated key, which is slower.
-	 */
-	res = DatumBigEndianToNative(res);
+	uuid_v1_abbrev_count(ssup, res);
 
 	return res;
 }
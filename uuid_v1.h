@@ -41,5 +41,41 @@ typedef struct pg_uuid_v1
 extern pg_uuid_v1* uuid_std_to_v1(const pg_uuid_t *uuid);
 extern pg_uuid_t* uuid_v1_to_std(const pg_uuid_v1 *uuid);
 extern TimestampTz uuid_v1_timestamptz(const pg_uuid_v1 *uuid);
+extern int64 to_uuid_timestamp(const TimestampTz ts);
+extern bool uuid_timestamp_in_range(const TimestampTz ts);
+extern int uuid_v1_cmp0(const pg_uuid_v1 *a, const pg_uuid_v1 *b);
+extern Oid uuid_v1_type_oid(Oid fn_oid);
+extern bool uuid_v1_array_from_std(const char *src, char *dst, bool skip_invalid);
+
+/* abbreviated keys, shared by the sort support of both operator classes */
+struct SortSupportData;
+extern void uuid_v1_abbrev_init(struct SortSupportData *ssup);
+extern void uuid_v1_abbrev_count(struct SortSupportData *ssup, Datum abbrev);
+
+/* comparison operators, recognized by the planner hooks */
+extern PGDLLEXPORT Datum uuid_v1_eq(PG_FUNCTION_ARGS);
+extern PGDLLEXPORT Datum uuid_v1_lt(PG_FUNCTION_ARGS);
+extern PGDLLEXPORT Datum uuid_v1_le(PG_FUNCTION_ARGS);
+extern PGDLLEXPORT Datum uuid_v1_gt(PG_FUNCTION_ARGS);
+extern PGDLLEXPORT Datum uuid_v1_ge(PG_FUNCTION_ARGS);
+extern PGDLLEXPORT Datum uuid_v1_eq_ts(PG_FUNCTION_ARGS);
+extern PGDLLEXPORT Datum uuid_v1_lt_ts(PG_FUNCTION_ARGS);
+extern PGDLLEXPORT Datum uuid_v1_le_ts(PG_FUNCTION_ARGS);
+extern PGDLLEXPORT Datum uuid_v1_gt_ts(PG_FUNCTION_ARGS);
+extern PGDLLEXPORT Datum uuid_v1_ge_ts(PG_FUNCTION_ARGS);
+
+/* uuid_v1_bloom.c */
+extern uint64 uuid_v1_bloom_hash(const pg_uuid_v1 *uuid, uint32 seed);
+extern bool uuid_v1_flat_agg_combine_nulls(FunctionCallInfo fcinfo, MemoryContext aggcontext,
+										   Datum *result);
+
+/* uuid_v1_node_lag.c */
+extern void uuid_v1_node_lag_init(void);
+
+/* uuid_v1_time_bucket.c */
+extern void uuid_v1_time_bucket_init(void);
+
+/* uuid_v1_time_map.c */
+extern void uuid_v1_time_map_init(void);
 
 #endif							/* UUID_V1_H */
@@ -0,0 +1,520 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * uuid_v1_bloom.c
+ *	  Bloom filter over version 1 UUID's.
+ *
+ * The filter is a plain varlena in a documented format, so that it can be
+ * cast to bytea and read or written by external tools:
+ *
+ *   offset  size  content (integers in network byte order)
+ *        0     4  magic "U1BF"
+ *        4     1  format version (1)
+ *        5     1  number of hash functions (k)
+ *        6     2  reserved (0)
+ *        8     4  seed
+ *       12     4  number of bits (m, a multiple of 64)
+ *       16   m/8  bits, bit i being (1 << (i % 8)) of byte i / 8
+ *
+ * Each UUID is hashed from its components, see uuid_v1_bloom_hash(), and the
+ * k bit positions are derived from the two 32 bit halves of that hash using
+ * double hashing: (h1 + i * (h2 | 1)) mod m for i in [0, k). Forcing h2 to be
+ * odd keeps the k positions from collapsing into one when h2 is zero.
+ */
+#include <math.h>
+
+#include "postgres.h"
+
+#include "datatype/timestamp.h"
+#include "fmgr.h"
+#include "port/pg_bswap.h"
+#include "utils/builtins.h"
+#include "utils/uuid.h"
+#include "uuid_v1.h"
+
+#if PG_VERSION_NUM >= 160000
+#include "varatt.h"
+#endif
+
+#ifndef M_LN2
+#define M_LN2 0.69314718055994530942
+#endif
+
+#define UUID_V1_BLOOM_MAGIC		0x55314246	/* "U1BF" */
+#define UUID_V1_BLOOM_VERSION	1
+#define UUID_V1_BLOOM_HEADER	16
+#define UUID_V1_BLOOM_MAX_K		32
+
+/* upper limit of the filter size (256MB) */
+#define UUID_V1_BLOOM_MAX_BITS	(UINT64CONST(1) << 31)
+
+/* decoded filter header */
+typedef struct uuid_v1_bloom_header
+{
+	int k;
+	uint32 seed;
+	uint32 nbits;
+} uuid_v1_bloom_header;
+
+static inline uint64 uuid_v1_bloom_fmix64(uint64 h);
+static void uuid_v1_bloom_read_header(const bytea *filter, uuid_v1_bloom_header *header);
+static bytea* uuid_v1_bloom_create(int64 expected_n, float8 fpr, int64 seed);
+static bool uuid_v1_bloom_test(const bytea *filter, const pg_uuid_v1 *uuid);
+
+PG_FUNCTION_INFO_V1(uuid_v1_bloom_in);
+PG_FUNCTION_INFO_V1(uuid_v1_bloom_out);
+PG_FUNCTION_INFO_V1(uuid_v1_bloom_recv);
+PG_FUNCTION_INFO_V1(uuid_v1_bloom_send);
+PG_FUNCTION_INFO_V1(uuid_v1_bloom_from_bytea);
+PG_FUNCTION_INFO_V1(uuid_v1_bloom_contains);
+PG_FUNCTION_INFO_V1(uuid_v1_bloom_contained);
+PG_FUNCTION_INFO_V1(uuid_v1_bloom_agg_transfn);
+PG_FUNCTION_INFO_V1(uuid_v1_bloom_agg_combinefn);
+PG_FUNCTION_INFO_V1(uuid_v1_bloom_agg_deserialfn);
+PG_FUNCTION_INFO_V1(uuid_v1_flat_agg_finalfn);
+PG_FUNCTION_INFO_V1(uuid_v1_flat_agg_serialfn);
+
+/*
+ * uuid_v1_bloom_fmix64
+ *	Finalization mix of MurmurHash3.
+ */
+static inline uint64
+uuid_v1_bloom_fmix64(uint64 h)
+{
+	h ^= h >> 33;
+	h *= UINT64CONST(0xff51afd7ed558ccd);
+	h ^= h >> 33;
+	h *= UINT64CONST(0xc4ceb9fe1a85ec53);
+	h ^= h >> 33;
+
+	return h;
+}
+
+/*
+ * uuid_v1_bloom_hash
+ *	Seeded 64 bit hash of a UUID.
+ *
+ * The node (as big-endian 48 bit integer) and the clock sequence form one
+ * 64 bit word (node | clock_seq << 48), the timestamp the other:
+ *
+ *   fmix64(fmix64(word ^ seed) ^ timestamp)
+ */
+uint64
+uuid_v1_bloom_hash(const pg_uuid_v1 *uuid, uint32 seed)
+{
+	uint64 word = ((uint64) (uuid->clock_seq & 0x3FFF)) << 48;
+	int i;
+
+	for (i = 0; i < UUID_NODE_LEN; i++)
+		word |= ((uint64) uuid->node[i]) << (8 * (UUID_NODE_LEN - 1 - i));
+
+	return uuid_v1_bloom_fmix64(uuid_v1_bloom_fmix64(word ^ seed) ^ (uint64) uuid->timestamp);
+}
+
+/*
+ * uuid_v1_bloom_read_header
+ *	Decode and validate the header of a filter.
+ */
+static void
+uuid_v1_bloom_read_header(const bytea *filter, uuid_v1_bloom_header *header)
+{
+	const unsigned char *data = (const unsigned char *) VARDATA_ANY(filter);
+	Size len = VARSIZE_ANY_EXHDR(filter);
+	uint32 value;
+
+	if (len < UUID_V1_BLOOM_HEADER)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				errmsg("invalid bloom filter: too short")));
+
+	memcpy(&value, data, sizeof(value));
+	if (pg_ntoh32(value) != UUID_V1_BLOOM_MAGIC)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				errmsg("invalid bloom filter: bad magic number")));
+
+	if (data[4] != UUID_V1_BLOOM_VERSION)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				errmsg("invalid bloom filter: unsupported version %d", data[4])));
+
+	header->k = data[5];
+	if (header->k < 1 || header->k > UUID_V1_BLOOM_MAX_K)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				errmsg("invalid bloom filter: bad number of hash functions %d", header->k)));
+
+	memcpy(&value, data + 8, sizeof(value));
+	header->seed = pg_ntoh32(value);
+
+	memcpy(&value, data + 12, sizeof(value));
+	header->nbits = pg_ntoh32(value);
+
+	if (header->nbits == 0 || header->nbits % 64 != 0 ||
+		len != UUID_V1_BLOOM_HEADER + (Size) header->nbits / 8)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				errmsg("invalid bloom filter: size does not match number of bits")));
+}
+
+/*
+ * uuid_v1_bloom_create
+ *	Create an empty filter sized for the expected number of elements and
+ *	false positive rate, hashing with the given seed.
+ */
+static bytea*
+uuid_v1_bloom_create(int64 expected_n, float8 fpr, int64 seed)
+{
+	double bits;
+	uint32 nbits;
+	int k;
+	bytea *filter;
+	unsigned char *data;
+	uint32 value;
+
+	if (expected_n < 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				errmsg("expected_n must be greater than zero")));
+
+	if (!(fpr > 0.0 && fpr < 1.0))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				errmsg("fpr must be between 0 and 1")));
+
+	if (seed < 0 || seed > PG_UINT32_MAX)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				errmsg("seed must be between 0 and %u", PG_UINT32_MAX)));
+
+	/* m = -n ln(p) / ln(2)^2, rounded up to whole 64 bit words */
+	bits = ceil(-(double) expected_n * log(fpr) / (M_LN2 * M_LN2) / 64.0) * 64.0;
+
+	if (bits > (double) UUID_V1_BLOOM_MAX_BITS)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				errmsg("bloom filter too large"),
+				errdetail("A filter for %lld elements with false positive rate %g requires %.0f bits, the maximum is %llu.",
+						  (long long) expected_n, fpr, bits,
+						  (unsigned long long) UUID_V1_BLOOM_MAX_BITS)));
+
+	nbits = (uint32) bits;
+
+	/* k = m / n ln(2) */
+	k = (int) rint(bits / (double) expected_n * M_LN2);
+	k = Max(1, Min(k, UUID_V1_BLOOM_MAX_K));
+
+	filter = (bytea *) palloc0(VARHDRSZ + UUID_V1_BLOOM_HEADER + nbits / 8);
+	SET_VARSIZE(filter, VARHDRSZ + UUID_V1_BLOOM_HEADER + nbits / 8);
+	data = (unsigned char *) VARDATA(filter);
+
+	value = pg_hton32(UUID_V1_BLOOM_MAGIC);
+	memcpy(data, &value, sizeof(value));
+	data[4] = UUID_V1_BLOOM_VERSION;
+	data[5] = (unsigned char) k;
+	value = pg_hton32((uint32) seed);
+	memcpy(data + 8, &value, sizeof(value));
+	value = pg_hton32(nbits);
+	memcpy(data + 12, &value, sizeof(value));
+
+	return filter;
+}
+
+/*
+ * uuid_v1_bloom_test
+ *	Check whether the UUID may be contained in the filter.
+ */
+static bool
+uuid_v1_bloom_test(const bytea *filter, const pg_uuid_v1 *uuid)
+{
+	const unsigned char *bits = (const unsigned char *) VARDATA_ANY(filter) + UUID_V1_BLOOM_HEADER;
+	uuid_v1_bloom_header header;
+	uint64 hash;
+	uint64 h1;
+	uint64 h2;
+	int i;
+
+	uuid_v1_bloom_read_header(filter, &header);
+
+	hash = uuid_v1_bloom_hash(uuid, header.seed);
+	h1 = hash & 0xFFFFFFFF;
+	h2 = (hash >> 32) | 1;
+
+	for (i = 0; i < header.k; i++)
+	{
+		uint64 bit = (h1 + i * h2) % header.nbits;
+
+		if ((bits[bit >> 3] & (1 << (bit & 7))) == 0)
+			return false;
+	}
+
+	return true;
+}
+
+Datum
+uuid_v1_bloom_in(PG_FUNCTION_ARGS)
+{
+	bytea *filter = DatumGetByteaPP(DirectFunctionCall1(byteain, PG_GETARG_DATUM(0)));
+	uuid_v1_bloom_header header;
+
+	uuid_v1_bloom_read_header(filter, &header);
+
+	PG_RETURN_BYTEA_P(filter);
+}
+
+Datum
+uuid_v1_bloom_out(PG_FUNCTION_ARGS)
+{
+	return byteaout(fcinfo);
+}
+
+Datum
+uuid_v1_bloom_recv(PG_FUNCTION_ARGS)
+{
+	bytea *filter = DatumGetByteaPP(DirectFunctionCall1(bytearecv, PG_GETARG_DATUM(0)));
+	uuid_v1_bloom_header header;
+
+	uuid_v1_bloom_read_header(filter, &header);
+
+	PG_RETURN_BYTEA_P(filter);
+}
+
+Datum
+uuid_v1_bloom_send(PG_FUNCTION_ARGS)
+{
+	return byteasend(fcinfo);
+}
+
+/*
+ * uuid_v1_bloom_from_bytea
+ *	Cast from bytea, validating the format.
+ */
+Datum
+uuid_v1_bloom_from_bytea(PG_FUNCTION_ARGS)
+{
+	bytea *filter = PG_GETARG_BYTEA_PP(0);
+	uuid_v1_bloom_header header;
+
+	uuid_v1_bloom_read_header(filter, &header);
+
+	PG_RETURN_BYTEA_P(filter);
+}
+
+/*
+ * uuid_v1_bloom_contains
+ *	Implementation of uuid_v1_bloom @> uuid_v1
+ */
+Datum
+uuid_v1_bloom_contains(PG_FUNCTION_ARGS)
+{
+	bytea *filter = PG_GETARG_BYTEA_PP(0);
+	pg_uuid_v1 *uuid = PG_GETARG_UUIDV1_P(1);
+
+	PG_RETURN_BOOL(uuid_v1_bloom_test(filter, uuid));
+}
+
+/*
+ * uuid_v1_bloom_contained
+ *	Implementation of uuid_v1 <@ uuid_v1_bloom
+ */
+Datum
+uuid_v1_bloom_contained(PG_FUNCTION_ARGS)
+{
+	pg_uuid_v1 *uuid = PG_GETARG_UUIDV1_P(0);
+	bytea *filter = PG_GETARG_BYTEA_PP(1);
+
+	PG_RETURN_BOOL(uuid_v1_bloom_test(filter, uuid));
+}
+
+/*
+ * uuid_v1_bloom_agg_transfn
+ *	Add a UUID to the filter, creating it on the first call.
+ *
+ * The state is the filter itself, allocated in the aggregate context. The
+ * seed argument is optional, without it the seed is zero.
+ */
+Datum
+uuid_v1_bloom_agg_transfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	bytea *filter;
+	uuid_v1_bloom_header header;
+	unsigned char *bits;
+	uint64 hash;
+	uint64 h1;
+	uint64 h2;
+	int i;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "uuid_v1_bloom_agg_transfn called in non-aggregate context");
+
+	if (PG_ARGISNULL(0))
+	{
+		MemoryContext oldcontext;
+		int64 seed = 0;
+
+		if (PG_ARGISNULL(2) || PG_ARGISNULL(3))
+			ereport(ERROR,
+					(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+					errmsg("expected_n and fpr must not be null")));
+
+		if (PG_NARGS() > 4)
+		{
+			if (PG_ARGISNULL(4))
+				ereport(ERROR,
+						(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+						errmsg("seed must not be null")));
+
+			seed = PG_GETARG_INT64(4);
+		}
+
+		oldcontext = MemoryContextSwitchTo(aggcontext);
+		filter = uuid_v1_bloom_create(PG_GETARG_INT64(2), PG_GETARG_FLOAT8(3), seed);
+		MemoryContextSwitchTo(oldcontext);
+	}
+	else
+		filter = (bytea *) PG_GETARG_POINTER(0);
+
+	if (PG_ARGISNULL(1))
+		PG_RETURN_POINTER(filter);
+
+	/* the header has been written by us, so there's no need to validate it */
+	header.k = ((unsigned char *) VARDATA(filter))[5];
+	memcpy(&header.seed, VARDATA(filter) + 8, sizeof(header.seed));
+	header.seed = pg_ntoh32(header.seed);
+	memcpy(&header.nbits, VARDATA(filter) + 12, sizeof(header.nbits));
+	header.nbits = pg_ntoh32(header.nbits);
+	bits = (unsigned char *) VARDATA(filter) + UUID_V1_BLOOM_HEADER;
+
+	hash = uuid_v1_bloom_hash(PG_GETARG_UUIDV1_P(1), header.seed);
+	h1 = hash & 0xFFFFFFFF;
+	h2 = (hash >> 32) | 1;
+
+	for (i = 0; i < header.k; i++)
+	{
+		uint64 bit = (h1 + i * h2) % header.nbits;
+
+		bits[bit >> 3] |= 1 << (bit & 7);
+	}
+
+	PG_RETURN_POINTER(filter);
+}
+
+/*
+ * uuid_v1_bloom_agg_combinefn
+ *	Merge two partial filters by OR-ing their bits.
+ */
+Datum
+uuid_v1_bloom_agg_combinefn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	Datum result;
+	bytea *state1;
+	bytea *state2;
+	uuid_v1_bloom_header header1;
+	uuid_v1_bloom_header header2;
+	unsigned char *dst;
+	const unsigned char *src;
+	Size i;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "uuid_v1_bloom_agg_combinefn called in non-aggregate context");
+
+	if (uuid_v1_flat_agg_combine_nulls(fcinfo, aggcontext, &result))
+		return result;
+
+	state1 = (bytea *) PG_GETARG_POINTER(0);
+	state2 = (bytea *) PG_GETARG_POINTER(1);
+
+	uuid_v1_bloom_read_header(state1, &header1);
+	uuid_v1_bloom_read_header(state2, &header2);
+
+	if (header1.k != header2.k || header1.seed != header2.seed ||
+		header1.nbits != header2.nbits)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				errmsg("cannot combine bloom filters with different parameters")));
+
+	dst = (unsigned char *) VARDATA(state1) + UUID_V1_BLOOM_HEADER;
+	src = (const unsigned char *) VARDATA(state2) + UUID_V1_BLOOM_HEADER;
+
+	for (i = 0; i < header1.nbits / 8; i++)
+		dst[i] |= src[i];
+
+	PG_RETURN_POINTER(state1);
+}
+
+Datum
+uuid_v1_bloom_agg_deserialfn(PG_FUNCTION_ARGS)
+{
+	bytea *serialized = PG_GETARG_BYTEA_P_COPY(0);
+	uuid_v1_bloom_header header;
+
+	uuid_v1_bloom_read_header(serialized, &header);
+
+	PG_RETURN_POINTER(serialized);
+}
+
+/*
+ * uuid_v1_flat_agg_combine_nulls
+ *	Combine function cases of aggregates keeping their state in a flat bytea
+ *	(bloom filters and hll sketches) with at least one state being NULL.
+ *
+ * Returns false if both states are set and have to be merged by the caller.
+ * Otherwise the result is the non-NULL state, copied into the aggregate
+ * context if it is the second one, or NULL.
+ */
+bool
+uuid_v1_flat_agg_combine_nulls(FunctionCallInfo fcinfo, MemoryContext aggcontext, Datum *result)
+{
+	bytea *state;
+
+	if (PG_ARGISNULL(1))
+	{
+		fcinfo->isnull = PG_ARGISNULL(0);
+		*result = fcinfo->isnull ? (Datum) 0 : PG_GETARG_DATUM(0);
+		return true;
+	}
+
+	if (!PG_ARGISNULL(0))
+		return false;
+
+	state = (bytea *) MemoryContextAlloc(aggcontext, VARSIZE(PG_GETARG_POINTER(1)));
+	memcpy(state, PG_GETARG_POINTER(1), VARSIZE(PG_GETARG_POINTER(1)));
+
+	*result = PointerGetDatum(state);
+	return true;
+}
+
+/*
+ * uuid_v1_flat_agg_finalfn
+ *	Final function of aggregates whose state is the resulting value.
+ */
+Datum
+uuid_v1_flat_agg_finalfn(PG_FUNCTION_ARGS)
+{
+	if (PG_ARGISNULL(0))
+		PG_RETURN_NULL();
+
+	PG_RETURN_BYTEA_P((bytea *) PG_GETARG_POINTER(0));
+}
+
+/*
+ * uuid_v1_flat_agg_serialfn
+ *	Serialization of flat bytea states, which need no conversion.
+ */
+Datum
+uuid_v1_flat_agg_serialfn(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_BYTEA_P((bytea *) PG_GETARG_POINTER(0));
+}
@@ -0,0 +1,650 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * uuid_v1_gap_stats.c
+ *	  Aggregate of the time gaps between consecutive UUID's of each node.
+ *
+ * The input is expected in time order per node, either by an ORDER BY in the
+ * aggregate call or by reading an index in uuid_v1_ops order, so the gaps can
+ * be computed from the previous timestamp of each node without sorting. The
+ * gaps, in ticks of 100 ns, are summarized in a merging t-digest of bounded
+ * size, so the memory used only depends on the number of nodes. Values older
+ * than the previous one of their node are counted as out of order and
+ * skipped.
+ *
+ * Partial states of partitionwise aggregation keep the range of time seen per
+ * node. When they are combined, the gaps between adjacent ranges are added at
+ * the end, which is exact as long as the partial inputs cover disjoint ranges
+ * of time, e.g. partitions by time. Overlapping ranges mean the partial inputs
+ * were interleaved, so the start of the later range is counted as one value
+ * out of order instead of a gap, like an interleaved serial input would be.
+ * The aggregate is not parallel safe, as the blocks read by the workers of a
+ * parallel scan always interleave, in an order that changes between runs.
+ */
+#include <math.h>
+
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "libpq/pqformat.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/timestamp.h"
+#include "utils/uuid.h"
+#include "uuid_v1.h"
+
+/* t-digest compression, about the number of centroids kept */
+#define GAP_STATS_COMPRESSION	100
+#define GAP_STATS_MAX_CENTROIDS	(2 * GAP_STATS_COMPRESSION)
+
+/* number of gaps buffered before they are merged into the centroids */
+#define GAP_STATS_BUFFER_SIZE	(5 * GAP_STATS_COMPRESSION)
+
+#define GAP_STATS_COLUMNS		5
+
+typedef struct gap_stats_centroid
+{
+	double mean;
+	double weight;
+} gap_stats_centroid;
+
+/* range of time seen of a node, the hash key is the node */
+typedef struct gap_stats_range
+{
+	unsigned char node[UUID_NODE_LEN];
+	int64 first;
+	int64 last;
+} gap_stats_range;
+
+typedef struct uuid_v1_gap_stats_state
+{
+	MemoryContext context;	/* aggregate context */
+	int64 gaps;				/* number of gaps */
+	int64 out_of_order;		/* values older than the previous one of their node */
+	int64 min_gap;
+	int64 max_gap;
+	HTAB *nodes;			/* gap_stats_range of each node */
+	gap_stats_range *extra;	/* further ranges of nodes, from combined states */
+	int nextra;
+	int maxextra;
+	int ncentroids;
+	int nbuffered;
+	gap_stats_centroid centroids[GAP_STATS_MAX_CENTROIDS];
+	/* unmerged gaps, with room for the centroids while merging */
+	gap_stats_centroid buffer[GAP_STATS_BUFFER_SIZE + GAP_STATS_MAX_CENTROIDS];
+} uuid_v1_gap_stats_state;
+
+static uuid_v1_gap_stats_state *gap_stats_create(MemoryContext context);
+static void gap_stats_add(uuid_v1_gap_stats_state *state, double mean, double weight);
+static void gap_stats_add_gap(uuid_v1_gap_stats_state *state, int64 gap);
+static void gap_stats_add_range(uuid_v1_gap_stats_state *state, const gap_stats_range *range);
+static void gap_stats_compress(uuid_v1_gap_stats_state *state);
+static double gap_stats_k(double q);
+static double gap_stats_quantile(uuid_v1_gap_stats_state *state, double q);
+static void gap_stats_boundaries(uuid_v1_gap_stats_state *state);
+static int gap_stats_centroid_cmp(const void *a, const void *b);
+static int gap_stats_range_cmp(const void *a, const void *b);
+static Interval *gap_stats_interval(double ticks);
+
+PG_FUNCTION_INFO_V1(uuid_v1_gap_stats_transfn);
+PG_FUNCTION_INFO_V1(uuid_v1_gap_stats_combinefn);
+PG_FUNCTION_INFO_V1(uuid_v1_gap_stats_finalfn);
+PG_FUNCTION_INFO_V1(uuid_v1_gap_stats_serialfn);
+PG_FUNCTION_INFO_V1(uuid_v1_gap_stats_deserialfn);
+
+/*
+ * gap_stats_create
+ *	Allocate an empty state in the aggregate context.
+ */
+static uuid_v1_gap_stats_state*
+gap_stats_create(MemoryContext context)
+{
+	uuid_v1_gap_stats_state *state;
+	HASHCTL info;
+
+	state = (uuid_v1_gap_stats_state *) MemoryContextAllocZero(context, sizeof(uuid_v1_gap_stats_state));
+	state->context = context;
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = UUID_NODE_LEN;
+	info.entrysize = sizeof(gap_stats_range);
+	info.hcxt = context;
+	state->nodes = hash_create("uuid_v1 gap stats nodes", 64, &info,
+							   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	return state;
+}
+
+/*
+ * gap_stats_add
+ *	Add a centroid to the buffer, merging the buffer once it is full.
+ */
+static void
+gap_stats_add(uuid_v1_gap_stats_state *state, double mean, double weight)
+{
+	if (state->nbuffered >= GAP_STATS_BUFFER_SIZE)
+		gap_stats_compress(state);
+
+	state->buffer[state->nbuffered].mean = mean;
+	state->buffer[state->nbuffered].weight = weight;
+	state->nbuffered++;
+}
+
+static void
+gap_stats_add_gap(uuid_v1_gap_stats_state *state, int64 gap)
+{
+	if (state->gaps == 0 || gap < state->min_gap)
+		state->min_gap = gap;
+	if (state->gaps == 0 || gap > state->max_gap)
+		state->max_gap = gap;
+
+	state->gaps++;
+	gap_stats_add(state, (double) gap, 1.0);
+}
+
+/*
+ * gap_stats_add_range
+ *	Add the range of time of a node seen by another state.
+ */
+static void
+gap_stats_add_range(uuid_v1_gap_stats_state *state, const gap_stats_range *range)
+{
+	gap_stats_range *entry;
+	bool found;
+
+	entry = hash_search(state->nodes, range->node, HASH_ENTER, &found);
+
+	if (!found)
+	{
+		entry->first = range->first;
+		entry->last = range->last;
+		return;
+	}
+
+	if (state->nextra >= state->maxextra)
+	{
+		state->maxextra = Max(16, state->maxextra * 2);
+
+		if (state->extra == NULL)
+			state->extra = MemoryContextAlloc(state->context, sizeof(gap_stats_range) * state->maxextra);
+		else
+			state->extra = repalloc(state->extra, sizeof(gap_stats_range) * state->maxextra);
+	}
+
+	state->extra[state->nextra++] = *range;
+}
+
+/*
+ * gap_stats_k
+ *	Scale function k1 of the t-digest, which keeps the centroids small
+ *	towards both tails of the distribution.
+ */
+static double
+gap_stats_k(double q)
+{
+	if (q > 1.0)
+		q = 1.0;
+
+	return GAP_STATS_COMPRESSION / (2.0 * M_PI) * asin(2.0 * q - 1.0);
+}
+
+/*
+ * gap_stats_compress
+ *	Merge the buffered centroids into the digest.
+ *
+ * All centroids are sorted by mean and adjacent ones merged, as long as the
+ * merged centroid spans no more than one unit of the scale function.
+ */
+static void
+gap_stats_compress(uuid_v1_gap_stats_state *state)
+{
+	gap_stats_centroid *all = state->buffer;
+	gap_stats_centroid current;
+	double total = 0.0;
+	double so_far = 0.0;
+	double k_lower;
+	int n;
+	int i;
+
+	if (state->nbuffered == 0)
+		return;
+
+	memcpy(all + state->nbuffered, state->centroids,
+		   sizeof(gap_stats_centroid) * state->ncentroids);
+	n = state->nbuffered + state->ncentroids;
+
+	qsort(all, n, sizeof(gap_stats_centroid), gap_stats_centroid_cmp);
+
+	for (i = 0; i < n; i++)
+		total += all[i].weight;
+
+	state->ncentroids = 0;
+	current = all[0];
+	k_lower = gap_stats_k(0.0);
+
+	for (i = 1; i < n; i++)
+	{
+		double q = (so_far + current.weight + all[i].weight) / total;
+
+		if (gap_stats_k(q) - k_lower <= 1.0)
+		{
+			current.weight += all[i].weight;
+			current.mean += (all[i].mean - current.mean) * all[i].weight / current.weight;
+		}
+		else
+		{
+			state->centroids[state->ncentroids++] = current;
+			so_far += current.weight;
+			k_lower = gap_stats_k(so_far / total);
+			current = all[i];
+		}
+	}
+
+	state->centroids[state->ncentroids++] = current;
+	state->nbuffered = 0;
+
+	Assert(state->ncentroids <= GAP_STATS_MAX_CENTROIDS);
+}
+
+/*
+ * gap_stats_quantile
+ *	Estimate a quantile of the gaps, interpolating linearly between the
+ *	centers of the centroids and the exact minimum and maximum.
+ */
+static double
+gap_stats_quantile(uuid_v1_gap_stats_state *state, double q)
+{
+	gap_stats_centroid *c;
+	double index;
+	double total = 0.0;
+	double center;
+	int i;
+
+	gap_stats_compress(state);
+
+	c = state->centroids;
+
+	for (i = 0; i < state->ncentroids; i++)
+		total += c[i].weight;
+
+	index = q * total;
+	center = c[0].weight / 2.0;
+
+	if (index <= center)
+	{
+		if (center <= 0.5)
+			return c[0].mean;
+
+		return state->min_gap + (c[0].mean - state->min_gap) * index / center;
+	}
+
+	for (i = 0; i < state->ncentroids - 1; i++)
+	{
+		double next = center + (c[i].weight + c[i + 1].weight) / 2.0;
+
+		if (index < next)
+			return c[i].mean + (c[i + 1].mean - c[i].mean) * (index - center) / (next - center);
+
+		center = next;
+	}
+
+	/* between the center of the last centroid and the maximum */
+	if (total - center <= 0.5)
+		return c[i].mean;
+
+	return c[i].mean + (state->max_gap - c[i].mean) * (index - center) / (total - center);
+}
+
+/*
+ * gap_stats_boundaries
+ *	Add the gaps between the ranges of time of each node seen by different
+ *	partial states, and merge the ranges. Overlapping ranges add a value out
+ *	of order instead.
+ */
+static void
+gap_stats_boundaries(uuid_v1_gap_stats_state *state)
+{
+	gap_stats_range *ranges;
+	gap_stats_range *range;
+	HASH_SEQ_STATUS status;
+	int n = 0;
+	int i;
+
+	if (state->nextra == 0)
+		return;
+
+	ranges = palloc(sizeof(gap_stats_range) * (hash_get_num_entries(state->nodes) + state->nextra));
+
+	hash_seq_init(&status, state->nodes);
+	while ((range = hash_seq_search(&status)) != NULL)
+		ranges[n++] = *range;
+
+	memcpy(ranges + n, state->extra, sizeof(gap_stats_range) * state->nextra);
+	n += state->nextra;
+
+	qsort(ranges, n, sizeof(gap_stats_range), gap_stats_range_cmp);
+
+	for (i = 1; i < n; i++)
+	{
+		if (memcmp(ranges[i].node, ranges[i - 1].node, UUID_NODE_LEN) != 0)
+			continue;
+
+		if (ranges[i].first < ranges[i - 1].last)
+			state->out_of_order++;
+		else
+			gap_stats_add_gap(state, ranges[i].first - ranges[i - 1].last);
+
+		/* the merged range, in the hash for the last range of the node */
+		ranges[i].first = ranges[i - 1].first;
+		ranges[i].last = Max(ranges[i].last, ranges[i - 1].last);
+		range = hash_search(state->nodes, ranges[i].node, HASH_FIND, NULL);
+		range->first = ranges[i].first;
+		range->last = ranges[i].last;
+	}
+
+	state->nextra = 0;
+
+	pfree(ranges);
+}
+
+static int
+gap_stats_centroid_cmp(const void *a, const void *b)
+{
+	double ma = ((const gap_stats_centroid *) a)->mean;
+	double mb = ((const gap_stats_centroid *) b)->mean;
+
+	if (ma < mb)
+		return -1;
+	else if (ma > mb)
+		return 1;
+
+	return 0;
+}
+
+static int
+gap_stats_range_cmp(const void *a, const void *b)
+{
+	const gap_stats_range *ra = (const gap_stats_range *) a;
+	const gap_stats_range *rb = (const gap_stats_range *) b;
+	int cmp = memcmp(ra->node, rb->node, UUID_NODE_LEN);
+
+	if (cmp != 0)
+		return cmp;
+
+	if (ra->first < rb->first)
+		return -1;
+	else if (ra->first > rb->first)
+		return 1;
+
+	return 0;
+}
+
+/*
+ * gap_stats_interval
+ *	Convert ticks of 100 ns into an interval.
+ */
+static Interval*
+gap_stats_interval(double ticks)
+{
+	Interval *result = (Interval *) palloc0(sizeof(Interval));
+
+	result->time = (int64) rint(ticks / 10.0);
+
+	return result;
+}
+
+/*
+ * uuid_v1_gap_stats_transfn
+ *	Add the gap to the previous UUID of the node.
+ */
+Datum
+uuid_v1_gap_stats_transfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	uuid_v1_gap_stats_state *state;
+	pg_uuid_v1 *uuid;
+	gap_stats_range *range;
+	bool found;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "uuid_v1_gap_stats_transfn called in non-aggregate context");
+
+	if (PG_ARGISNULL(0))
+		state = gap_stats_create(aggcontext);
+	else
+		state = (uuid_v1_gap_stats_state *) PG_GETARG_POINTER(0);
+
+	if (PG_ARGISNULL(1))
+		PG_RETURN_POINTER(state);
+
+	uuid = PG_GETARG_UUIDV1_P(1);
+	range = hash_search(state->nodes, uuid->node, HASH_ENTER, &found);
+
+	if (!found)
+	{
+		range->first = uuid->timestamp;
+		range->last = uuid->timestamp;
+	}
+	else if (uuid->timestamp < range->last)
+		state->out_of_order++;
+	else
+	{
+		gap_stats_add_gap(state, uuid->timestamp - range->last);
+		range->last = uuid->timestamp;
+	}
+
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * uuid_v1_gap_stats_combinefn
+ *	Merge two partial states, keeping the ranges of time of both.
+ */
+Datum
+uuid_v1_gap_stats_combinefn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	uuid_v1_gap_stats_state *state1;
+	uuid_v1_gap_stats_state *state2;
+	gap_stats_range *range;
+	HASH_SEQ_STATUS status;
+	int i;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "uuid_v1_gap_stats_combinefn called in non-aggregate context");
+
+	if (PG_ARGISNULL(1))
+	{
+		if (PG_ARGISNULL(0))
+			PG_RETURN_NULL();
+
+		PG_RETURN_POINTER(PG_GETARG_POINTER(0));
+	}
+
+	state2 = (uuid_v1_gap_stats_state *) PG_GETARG_POINTER(1);
+
+	if (PG_ARGISNULL(0))
+		state1 = gap_stats_create(aggcontext);
+	else
+		state1 = (uuid_v1_gap_stats_state *) PG_GETARG_POINTER(0);
+
+	if (state2->gaps > 0)
+	{
+		if (state1->gaps == 0 || state2->min_gap < state1->min_gap)
+			state1->min_gap = state2->min_gap;
+		if (state1->gaps == 0 || state2->max_gap > state1->max_gap)
+			state1->max_gap = state2->max_gap;
+	}
+
+	state1->gaps += state2->gaps;
+	state1->out_of_order += state2->out_of_order;
+
+	for (i = 0; i < state2->ncentroids; i++)
+		gap_stats_add(state1, state2->centroids[i].mean, state2->centroids[i].weight);
+
+	for (i = 0; i < state2->nbuffered; i++)
+		gap_stats_add(state1, state2->buffer[i].mean, state2->buffer[i].weight);
+
+	hash_seq_init(&status, state2->nodes);
+	while ((range = hash_seq_search(&status)) != NULL)
+		gap_stats_add_range(state1, range);
+
+	for (i = 0; i < state2->nextra; i++)
+		gap_stats_add_range(state1, &state2->extra[i]);
+
+	PG_RETURN_POINTER(state1);
+}
+
+/*
+ * uuid_v1_gap_stats_finalfn
+ *	Number of gaps and values out of order, median, 99th percentile and
+ *	maximum of the gaps.
+ */
+Datum
+uuid_v1_gap_stats_finalfn(PG_FUNCTION_ARGS)
+{
+	uuid_v1_gap_stats_state *state;
+	TupleDesc tupdesc;
+	Datum values[GAP_STATS_COLUMNS];
+	bool nulls[GAP_STATS_COLUMNS];
+
+	if (PG_ARGISNULL(0))
+		PG_RETURN_NULL();
+
+	state = (uuid_v1_gap_stats_state *) PG_GETARG_POINTER(0);
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	tupdesc = BlessTupleDesc(tupdesc);
+
+	gap_stats_boundaries(state);
+
+	memset(nulls, 0, sizeof(nulls));
+	values[0] = Int64GetDatum(state->gaps);
+	values[1] = Int64GetDatum(state->out_of_order);
+
+	if (state->gaps > 0)
+	{
+		values[2] = IntervalPGetDatum(gap_stats_interval(gap_stats_quantile(state, 0.5)));
+		values[3] = IntervalPGetDatum(gap_stats_interval(gap_stats_quantile(state, 0.99)));
+		values[4] = IntervalPGetDatum(gap_stats_interval((double) state->max_gap));
+	}
+	else
+		nulls[2] = nulls[3] = nulls[4] = true;
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
+/*
+ * uuid_v1_gap_stats_serialfn
+ *	Counters, centroids and ranges of time of the nodes, in network byte
+ *	order.
+ */
+Datum
+uuid_v1_gap_stats_serialfn(PG_FUNCTION_ARGS)
+{
+	uuid_v1_gap_stats_state *state = (uuid_v1_gap_stats_state *) PG_GETARG_POINTER(0);
+	gap_stats_range *range;
+	HASH_SEQ_STATUS status;
+	StringInfoData buf;
+	int i;
+
+	pq_begintypsend(&buf);
+
+	pq_sendint64(&buf, state->gaps);
+	pq_sendint64(&buf, state->out_of_order);
+	pq_sendint64(&buf, state->min_gap);
+	pq_sendint64(&buf, state->max_gap);
+
+	pq_sendint32(&buf, state->ncentroids + state->nbuffered);
+	for (i = 0; i < state->ncentroids; i++)
+	{
+		pq_sendfloat8(&buf, state->centroids[i].mean);
+		pq_sendfloat8(&buf, state->centroids[i].weight);
+	}
+	for (i = 0; i < state->nbuffered; i++)
+	{
+		pq_sendfloat8(&buf, state->buffer[i].mean);
+		pq_sendfloat8(&buf, state->buffer[i].weight);
+	}
+
+	pq_sendint32(&buf, hash_get_num_entries(state->nodes) + state->nextra);
+	hash_seq_init(&status, state->nodes);
+	while ((range = hash_seq_search(&status)) != NULL)
+	{
+		pq_sendbytes(&buf, (char *) range->node, UUID_NODE_LEN);
+		pq_sendint64(&buf, range->first);
+		pq_sendint64(&buf, range->last);
+	}
+	for (i = 0; i < state->nextra; i++)
+	{
+		pq_sendbytes(&buf, (char *) state->extra[i].node, UUID_NODE_LEN);
+		pq_sendint64(&buf, state->extra[i].first);
+		pq_sendint64(&buf, state->extra[i].last);
+	}
+
+	PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+Datum
+uuid_v1_gap_stats_deserialfn(PG_FUNCTION_ARGS)
+{
+	bytea *serialized = PG_GETARG_BYTEA_PP(0);
+	MemoryContext aggcontext;
+	uuid_v1_gap_stats_state *state;
+	StringInfoData buf;
+	int n;
+	int i;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "uuid_v1_gap_stats_deserialfn called in non-aggregate context");
+
+	initStringInfo(&buf);
+	appendBinaryStringInfo(&buf, VARDATA_ANY(serialized), VARSIZE_ANY_EXHDR(serialized));
+
+	state = gap_stats_create(aggcontext);
+
+	state->gaps = pq_getmsgint64(&buf);
+	state->out_of_order = pq_getmsgint64(&buf);
+	state->min_gap = pq_getmsgint64(&buf);
+	state->max_gap = pq_getmsgint64(&buf);
+
+	n = pq_getmsgint(&buf, 4);
+	for (i = 0; i < n; i++)
+	{
+		double mean = pq_getmsgfloat8(&buf);
+		double weight = pq_getmsgfloat8(&buf);
+
+		gap_stats_add(state, mean, weight);
+	}
+
+	n = pq_getmsgint(&buf, 4);
+	for (i = 0; i < n; i++)
+	{
+		gap_stats_range range;
+
+		pq_copymsgbytes(&buf, (char *) range.node, UUID_NODE_LEN);
+		range.first = pq_getmsgint64(&buf);
+		range.last = pq_getmsgint64(&buf);
+
+		gap_stats_add_range(state, &range);
+	}
+
+	pq_getmsgend(&buf);
+	pfree(buf.data);
+
+	PG_RETURN_POINTER(state);
+}
@@ -0,0 +1,504 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * uuid_v1_hll.c
+ *	  HyperLogLog sketches for approximate distinct counts of version 1 UUID's.
+ *
+ * lib/hyperloglog.h keeps its registers in a separately allocated array and
+ * works on 32 bit hashes, which saturate at a few billion distinct values, so
+ * the sketch is implemented here as a plain varlena instead. That makes the
+ * aggregate state its own serialized form and lets sketches be stored, cast
+ * to bytea and merged later:
+ *
+ *   offset  size  content
+ *        0     4  magic "U1HL" (network byte order)
+ *        4     1  format version (1)
+ *        5     1  precision (p, number of index bits)
+ *        6     2  reserved (0)
+ *        8   2^p  registers, one byte each
+ *
+ * Values are hashed to 64 bits, the upper p bits select the register, which
+ * keeps the maximum position of the leftmost one bit in the remaining bits.
+ */
+#include <math.h>
+
+#include "postgres.h"
+
+#include "datatype/timestamp.h"
+#include "fmgr.h"
+#include "port/pg_bitutils.h"
+#include "port/pg_bswap.h"
+#include "utils/builtins.h"
+#include "utils/uuid.h"
+#include "uuid_v1.h"
+
+#if PG_VERSION_NUM >= 160000
+#include "varatt.h"
+#endif
+
+#define UUID_V1_HLL_MAGIC		0x5531484C	/* "U1HL" */
+#define UUID_V1_HLL_VERSION		1
+#define UUID_V1_HLL_HEADER		8
+#define UUID_V1_HLL_MIN_P		4
+#define UUID_V1_HLL_MAX_P		18
+
+/* precision of new sketches, 16384 registers with a standard error of 0.8% */
+#define UUID_V1_HLL_P			14
+
+static int uuid_v1_hll_precision(const bytea *sketch);
+static void uuid_v1_hll_validate(const bytea *sketch);
+static bytea* uuid_v1_hll_create(int p);
+static void uuid_v1_hll_add(bytea *sketch, uint64 hash);
+static void uuid_v1_hll_merge(bytea *dst, const bytea *src);
+static int64 uuid_v1_hll_estimate(const bytea *sketch);
+static bytea* uuid_v1_hll_state(FunctionCallInfo fcinfo, const char *name);
+
+PG_FUNCTION_INFO_V1(uuid_v1_hll_in);
+PG_FUNCTION_INFO_V1(uuid_v1_hll_out);
+PG_FUNCTION_INFO_V1(uuid_v1_hll_recv);
+PG_FUNCTION_INFO_V1(uuid_v1_hll_send);
+PG_FUNCTION_INFO_V1(uuid_v1_hll_from_bytea);
+PG_FUNCTION_INFO_V1(uuid_v1_hll_cardinality);
+PG_FUNCTION_INFO_V1(uuid_v1_hll_union);
+PG_FUNCTION_INFO_V1(uuid_v1_hll_add_transfn);
+PG_FUNCTION_INFO_V1(uuid_v1_hll_node_transfn);
+PG_FUNCTION_INFO_V1(uuid_v1_hll_union_transfn);
+PG_FUNCTION_INFO_V1(uuid_v1_hll_combinefn);
+PG_FUNCTION_INFO_V1(uuid_v1_hll_count_finalfn);
+PG_FUNCTION_INFO_V1(uuid_v1_hll_deserialfn);
+
+/*
+ * uuid_v1_hll_precision
+ *	Validate the header of a sketch and return its precision.
+ */
+static int
+uuid_v1_hll_precision(const bytea *sketch)
+{
+	const unsigned char *data = (const unsigned char *) VARDATA_ANY(sketch);
+	Size len = VARSIZE_ANY_EXHDR(sketch);
+	uint32 value;
+	int p;
+
+	if (len < UUID_V1_HLL_HEADER)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				errmsg("invalid hll sketch: too short")));
+
+	memcpy(&value, data, sizeof(value));
+	if (pg_ntoh32(value) != UUID_V1_HLL_MAGIC)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				errmsg("invalid hll sketch: bad magic number")));
+
+	if (data[4] != UUID_V1_HLL_VERSION)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				errmsg("invalid hll sketch: unsupported version %d", data[4])));
+
+	p = data[5];
+	if (p < UUID_V1_HLL_MIN_P || p > UUID_V1_HLL_MAX_P)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				errmsg("invalid hll sketch: bad precision %d", p)));
+
+	if (len != UUID_V1_HLL_HEADER + ((Size) 1 << p))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				errmsg("invalid hll sketch: size does not match precision")));
+
+	return p;
+}
+
+/*
+ * uuid_v1_hll_validate
+ *	Validate a sketch coming from outside, including all registers.
+ *
+ * Sketches of type uuid_v1_hll only get here through input, receive or the
+ * cast from bytea, so the other functions can rely on valid registers and
+ * only need to look at the header.
+ */
+static void
+uuid_v1_hll_validate(const bytea *sketch)
+{
+	const unsigned char *data = (const unsigned char *) VARDATA_ANY(sketch);
+	Size len = VARSIZE_ANY_EXHDR(sketch);
+	int p = uuid_v1_hll_precision(sketch);
+	Size i;
+
+	/* a register can't exceed the number of hash bits left plus one */
+	for (i = UUID_V1_HLL_HEADER; i < len; i++)
+	{
+		if (data[i] > 64 - p + 1)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+					errmsg("invalid hll sketch: register value out of range")));
+	}
+}
+
+/*
+ * uuid_v1_hll_create
+ *	Create an empty sketch with 2^p registers.
+ */
+static bytea*
+uuid_v1_hll_create(int p)
+{
+	Size len = VARHDRSZ + UUID_V1_HLL_HEADER + ((Size) 1 << p);
+	bytea *sketch = (bytea *) palloc0(len);
+	unsigned char *data = (unsigned char *) VARDATA(sketch);
+	uint32 value = pg_hton32(UUID_V1_HLL_MAGIC);
+
+	SET_VARSIZE(sketch, len);
+	memcpy(data, &value, sizeof(value));
+	data[4] = UUID_V1_HLL_VERSION;
+	data[5] = (unsigned char) p;
+
+	return sketch;
+}
+
+/*
+ * uuid_v1_hll_add
+ *	Add a hash value to a sketch created by us.
+ */
+static void
+uuid_v1_hll_add(bytea *sketch, uint64 hash)
+{
+	unsigned char *data = (unsigned char *) VARDATA(sketch);
+	int p = data[5];
+	uint64 index = hash >> (64 - p);
+	/* the guard bit limits the rank to 64 - p + 1 */
+	uint64 rest = (hash << p) | (UINT64CONST(1) << (p - 1));
+	unsigned char rank = (unsigned char) (64 - pg_leftmost_one_pos64(rest));
+
+	if (data[UUID_V1_HLL_HEADER + index] < rank)
+		data[UUID_V1_HLL_HEADER + index] = rank;
+}
+
+/*
+ * uuid_v1_hll_merge
+ *	Merge src into dst, taking the maximum of each register.
+ *
+ * Both sketches have been validated already, so only their precision has to
+ * match.
+ */
+static void
+uuid_v1_hll_merge(bytea *dst, const bytea *src)
+{
+	unsigned char *d = (unsigned char *) VARDATA(dst);
+	const unsigned char *s = (const unsigned char *) VARDATA_ANY(src);
+	Size nregisters;
+	Size i;
+
+	if (d[5] != s[5])
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				errmsg("cannot combine hll sketches with different precision")));
+
+	nregisters = (Size) 1 << d[5];
+
+	for (i = UUID_V1_HLL_HEADER; i < UUID_V1_HLL_HEADER + nregisters; i++)
+	{
+		if (d[i] < s[i])
+			d[i] = s[i];
+	}
+}
+
+/*
+ * uuid_v1_hll_estimate
+ *	Estimate the number of distinct values.
+ *
+ * This is the original HyperLogLog estimator with linear counting for small
+ * cardinalities. As the hashes have 64 bits, no large range correction is
+ * needed.
+ */
+static int64
+uuid_v1_hll_estimate(const bytea *sketch)
+{
+	const unsigned char *data = (const unsigned char *) VARDATA_ANY(sketch);
+	int p = data[5];
+	double m = (double) ((Size) 1 << p);
+	double alpha;
+	double sum = 0.0;
+	double estimate;
+	Size zeros = 0;
+	Size i;
+
+	switch (p)
+	{
+		case 4:
+			alpha = 0.673;
+			break;
+		case 5:
+			alpha = 0.697;
+			break;
+		case 6:
+			alpha = 0.709;
+			break;
+		default:
+			alpha = 0.7213 / (1.0 + 1.079 / m);
+			break;
+	}
+
+	for (i = 0; i < ((Size) 1 << p); i++)
+	{
+		unsigned char rank = data[UUID_V1_HLL_HEADER + i];
+
+		sum += ldexp(1.0, -rank);
+		if (rank == 0)
+			zeros++;
+	}
+
+	estimate = alpha * m * m / sum;
+
+	if (estimate <= 2.5 * m && zeros > 0)
+		estimate = m * log(m / (double) zeros);
+
+	return (int64) rint(estimate);
+}
+
+/*
+ * uuid_v1_hll_state
+ *	Return the aggregate state, creating an empty sketch on the first call.
+ */
+static bytea*
+uuid_v1_hll_state(FunctionCallInfo fcinfo, const char *name)
+{
+	MemoryContext aggcontext;
+	MemoryContext oldcontext;
+	bytea *sketch;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "%s called in non-aggregate context", name);
+
+	if (!PG_ARGISNULL(0))
+		return (bytea *) PG_GETARG_POINTER(0);
+
+	oldcontext = MemoryContextSwitchTo(aggcontext);
+	sketch = uuid_v1_hll_create(UUID_V1_HLL_P);
+	MemoryContextSwitchTo(oldcontext);
+
+	return sketch;
+}
+
+Datum
+uuid_v1_hll_in(PG_FUNCTION_ARGS)
+{
+	bytea *sketch = DatumGetByteaPP(DirectFunctionCall1(byteain, PG_GETARG_DATUM(0)));
+
+	uuid_v1_hll_validate(sketch);
+
+	PG_RETURN_BYTEA_P(sketch);
+}
+
+Datum
+uuid_v1_hll_out(PG_FUNCTION_ARGS)
+{
+	return byteaout(fcinfo);
+}
+
+Datum
+uuid_v1_hll_recv(PG_FUNCTION_ARGS)
+{
+	bytea *sketch = DatumGetByteaPP(DirectFunctionCall1(bytearecv, PG_GETARG_DATUM(0)));
+
+	uuid_v1_hll_validate(sketch);
+
+	PG_RETURN_BYTEA_P(sketch);
+}
+
+Datum
+uuid_v1_hll_send(PG_FUNCTION_ARGS)
+{
+	return byteasend(fcinfo);
+}
+
+/*
+ * uuid_v1_hll_from_bytea
+ *	Cast from bytea, validating the format.
+ */
+Datum
+uuid_v1_hll_from_bytea(PG_FUNCTION_ARGS)
+{
+	bytea *sketch = PG_GETARG_BYTEA_PP(0);
+
+	uuid_v1_hll_validate(sketch);
+
+	PG_RETURN_BYTEA_P(sketch);
+}
+
+/*
+ * uuid_v1_hll_cardinality
+ *	Estimated number of distinct values added to the sketch.
+ */
+Datum
+uuid_v1_hll_cardinality(PG_FUNCTION_ARGS)
+{
+	bytea *sketch = PG_GETARG_BYTEA_PP(0);
+
+	PG_RETURN_INT64(uuid_v1_hll_estimate(sketch));
+}
+
+/*
+ * uuid_v1_hll_union
+ *	Sketch of the union of the values of both sketches.
+ */
+Datum
+uuid_v1_hll_union(PG_FUNCTION_ARGS)
+{
+	bytea *a = PG_GETARG_BYTEA_PP(0);
+	bytea *b = PG_GETARG_BYTEA_PP(1);
+	bytea *result = (bytea *) palloc(VARHDRSZ + VARSIZE_ANY_EXHDR(a));
+
+	SET_VARSIZE(result, VARHDRSZ + VARSIZE_ANY_EXHDR(a));
+	memcpy(VARDATA(result), VARDATA_ANY(a), VARSIZE_ANY_EXHDR(a));
+
+	uuid_v1_hll_merge(result, b);
+
+	PG_RETURN_BYTEA_P(result);
+}
+
+/*
+ * uuid_v1_hll_add_transfn
+ *	Add a UUID to the sketch.
+ *
+ * The state is the sketch itself, allocated in the aggregate context. The
+ * UUID's are hashed like for bloom filters (with a seed of zero).
+ */
+Datum
+uuid_v1_hll_add_transfn(PG_FUNCTION_ARGS)
+{
+	bytea *sketch = uuid_v1_hll_state(fcinfo, "uuid_v1_hll_add_transfn");
+
+	if (!PG_ARGISNULL(1))
+		uuid_v1_hll_add(sketch, uuid_v1_bloom_hash(PG_GETARG_UUIDV1_P(1), 0));
+
+	PG_RETURN_POINTER(sketch);
+}
+
+/*
+ * uuid_v1_hll_node_transfn
+ *	Add the node of a UUID to the sketch.
+ *
+ * The node is hashed as a UUID with all other fields zero, so the hash only
+ * depends on the node.
+ */
+Datum
+uuid_v1_hll_node_transfn(PG_FUNCTION_ARGS)
+{
+	bytea *sketch = uuid_v1_hll_state(fcinfo, "uuid_v1_hll_node_transfn");
+
+	if (!PG_ARGISNULL(1))
+	{
+		pg_uuid_v1 node;
+
+		memset(&node, 0, sizeof(node));
+		memcpy(node.node, PG_GETARG_UUIDV1_P(1)->node, UUID_NODE_LEN);
+
+		uuid_v1_hll_add(sketch, uuid_v1_bloom_hash(&node, 0));
+	}
+
+	PG_RETURN_POINTER(sketch);
+}
+
+/*
+ * uuid_v1_hll_union_transfn
+ *	Merge a stored sketch into the state.
+ */
+Datum
+uuid_v1_hll_union_transfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	bytea *sketch;
+	bytea *input;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "uuid_v1_hll_union_transfn called in non-aggregate context");
+
+	if (PG_ARGISNULL(1))
+	{
+		if (PG_ARGISNULL(0))
+			PG_RETURN_NULL();
+
+		PG_RETURN_POINTER(PG_GETARG_POINTER(0));
+	}
+
+	input = PG_GETARG_BYTEA_PP(1);
+
+	if (PG_ARGISNULL(0))
+	{
+		/* adopt the precision of the first input */
+		MemoryContext oldcontext = MemoryContextSwitchTo(aggcontext);
+
+		sketch = uuid_v1_hll_create(uuid_v1_hll_precision(input));
+		MemoryContextSwitchTo(oldcontext);
+	}
+	else
+		sketch = (bytea *) PG_GETARG_POINTER(0);
+
+	uuid_v1_hll_merge(sketch, input);
+
+	PG_RETURN_POINTER(sketch);
+}
+
+/*
+ * uuid_v1_hll_combinefn
+ *	Merge two partial sketches.
+ */
+Datum
+uuid_v1_hll_combinefn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	Datum result;
+	bytea *state1;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "uuid_v1_hll_combinefn called in non-aggregate context");
+
+	if (uuid_v1_flat_agg_combine_nulls(fcinfo, aggcontext, &result))
+		return result;
+
+	state1 = (bytea *) PG_GETARG_POINTER(0);
+
+	uuid_v1_hll_merge(state1, (bytea *) PG_GETARG_POINTER(1));
+
+	PG_RETURN_POINTER(state1);
+}
+
+/*
+ * uuid_v1_hll_count_finalfn
+ *	Estimated number of distinct values, zero for no input like count().
+ */
+Datum
+uuid_v1_hll_count_finalfn(PG_FUNCTION_ARGS)
+{
+	if (PG_ARGISNULL(0))
+		PG_RETURN_INT64(0);
+
+	PG_RETURN_INT64(uuid_v1_hll_estimate((bytea *) PG_GETARG_POINTER(0)));
+}
+
+/*
+ * uuid_v1_hll_deserialfn
+ *	Copy a partial sketch serialized by another process.
+ *
+ * Partial states come from our own workers, which only write valid
+ * registers, so checking the header is enough.
+ */
+Datum
+uuid_v1_hll_deserialfn(PG_FUNCTION_ARGS)
+{
+	bytea *serialized = PG_GETARG_BYTEA_P_COPY(0);
+
+	uuid_v1_hll_precision(serialized);
+
+	PG_RETURN_POINTER(serialized);
+}
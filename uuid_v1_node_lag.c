@@ -0,0 +1,538 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * uuid_v1_node_lag.c
+ *	  Per-node ingest lag and clock skew monitor kept in shared memory.
+ *
+ * Every version 1 UUID carries the time and node where it was generated, so
+ * by looking at the UUID's of inserted rows we can tell how far behind each
+ * producer is and whether its clock runs ahead of ours. The statistics live
+ * in a fixed-size, open-addressing table keyed by the 48-bit node and are
+ * updated with plain atomic operations only, so the trigger can be left
+ * enabled under full write load.
+ */
+#include "postgres.h"
+
+#include "access/hash.h"
+#include "access/htup_details.h"
+#include "catalog/pg_type.h"
+#include "commands/trigger.h"
+#include "executor/spi.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "port/atomics.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/lsyscache.h"
+#include "utils/timestamp.h"
+#include "utils/tuplestore.h"
+#include "utils/uuid.h"
+#include "uuid_v1.h"
+
+/* marks a slot as used, as a node value of all zeros is perfectly valid */
+#define NODE_LAG_USED			(UINT64CONST(1) << 48)
+
+/* clock sequence values only use 14 bits */
+#define NODE_LAG_NO_CLOCKSEQ	PG_UINT32_MAX
+
+/*
+ * Lag histogram buckets: the first one counts UUID's generated in the future
+ * (clock of the producer is ahead of ours), the remaining ones are bounded
+ * by the upper limits below in microseconds, the last one is open.
+ */
+#define NODE_LAG_BUCKETS		9
+
+static const int64 node_lag_bounds[NODE_LAG_BUCKETS - 2] = {
+	INT64CONST(1000),			/* 1 ms */
+	INT64CONST(10000),			/* 10 ms */
+	INT64CONST(100000),			/* 100 ms */
+	INT64CONST(1000000),		/* 1 s */
+	INT64CONST(10000000),		/* 10 s */
+	INT64CONST(60000000),		/* 1 min */
+	INT64CONST(600000000)		/* 10 min */
+};
+
+typedef struct uuid_v1_node_lag_slot
+{
+	pg_atomic_uint64 node;			/* node | NODE_LAG_USED, 0 if unused */
+	pg_atomic_uint64 rows;			/* number of rows seen */
+	pg_atomic_uint64 late_rows;		/* rows older than the newest one seen */
+	pg_atomic_uint64 newest;		/* newest UUID timestamp (100 ns ticks) */
+	pg_atomic_uint64 last_seen;		/* wall clock of the last insert */
+	pg_atomic_uint64 max_ahead;		/* max. clock skew into the future (us) */
+	pg_atomic_uint64 clock_seq_changes;
+	pg_atomic_uint32 clock_seq;		/* last clock sequence seen */
+	pg_atomic_uint64 lag_hist[NODE_LAG_BUCKETS];
+} uuid_v1_node_lag_slot;
+
+typedef struct uuid_v1_node_lag_shared
+{
+	int nslots;
+	pg_atomic_uint64 overflow;		/* rows not tracked due to a full table */
+	uuid_v1_node_lag_slot slots[FLEXIBLE_ARRAY_MEMBER];
+} uuid_v1_node_lag_shared;
+
+/* cached attribute lookup of the trigger */
+typedef struct uuid_v1_node_lag_cache
+{
+	Oid relid;
+	int attnum;
+} uuid_v1_node_lag_cache;
+
+/* GUC: maximum number of distinct nodes tracked */
+static int node_lag_max_nodes = 1024;
+
+static uuid_v1_node_lag_shared *node_lag = NULL;
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+#if PG_VERSION_NUM >= 150000
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+#endif
+
+static Size node_lag_memsize(void);
+static void node_lag_shmem_request(void);
+static void node_lag_shmem_startup(void);
+static void node_lag_check_loaded(void);
+static uuid_v1_node_lag_slot* node_lag_slot(const unsigned char *node);
+static bool node_lag_atomic_max(pg_atomic_uint64 *ptr, uint64 value);
+static void node_lag_record(const pg_uuid_v1 *uuid, TimestampTz now);
+
+PG_FUNCTION_INFO_V1(uuid_v1_node_lag_trigger);
+PG_FUNCTION_INFO_V1(uuid_v1_node_lag);
+PG_FUNCTION_INFO_V1(uuid_v1_node_lag_reset);
+
+/*
+ * uuid_v1_node_lag_init
+ *	Module load callback, only defines the settings and allocates shared
+ *	memory if we are loaded via shared_preload_libraries (settings of
+ *	PGC_POSTMASTER context can't be defined later on).
+ */
+void
+uuid_v1_node_lag_init(void)
+{
+	if (!process_shared_preload_libraries_in_progress)
+		return;
+
+	DefineCustomIntVariable("uuid_v1.node_lag_max_nodes",
+							"Sets the maximum number of nodes tracked by the ingest lag monitor.",
+							NULL,
+							&node_lag_max_nodes,
+							1024,
+							16,
+							1024 * 1024,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+#if PG_VERSION_NUM >= 150000
+	prev_shmem_request_hook = shmem_request_hook;
+	shmem_request_hook = node_lag_shmem_request;
+#else
+	node_lag_shmem_request();
+#endif
+
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = node_lag_shmem_startup;
+}
+
+static Size
+node_lag_memsize(void)
+{
+	return add_size(offsetof(uuid_v1_node_lag_shared, slots),
+					mul_size(node_lag_max_nodes, sizeof(uuid_v1_node_lag_slot)));
+}
+
+static void
+node_lag_shmem_request(void)
+{
+#if PG_VERSION_NUM >= 150000
+	if (prev_shmem_request_hook)
+		prev_shmem_request_hook();
+#endif
+
+	RequestAddinShmemSpace(node_lag_memsize());
+}
+
+static void
+node_lag_shmem_startup(void)
+{
+	bool found;
+	int i, j;
+
+	if (prev_shmem_startup_hook)
+		prev_shmem_startup_hook();
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	node_lag = ShmemInitStruct("uuid_v1 node lag", node_lag_memsize(), &found);
+
+	if (!found)
+	{
+		node_lag->nslots = node_lag_max_nodes;
+		pg_atomic_init_u64(&node_lag->overflow, 0);
+
+		for (i = 0; i < node_lag->nslots; i++)
+		{
+			uuid_v1_node_lag_slot *slot = &node_lag->slots[i];
+
+			pg_atomic_init_u64(&slot->node, 0);
+			pg_atomic_init_u64(&slot->rows, 0);
+			pg_atomic_init_u64(&slot->late_rows, 0);
+			pg_atomic_init_u64(&slot->newest, 0);
+			pg_atomic_init_u64(&slot->last_seen, 0);
+			pg_atomic_init_u64(&slot->max_ahead, 0);
+			pg_atomic_init_u64(&slot->clock_seq_changes, 0);
+			pg_atomic_init_u32(&slot->clock_seq, NODE_LAG_NO_CLOCKSEQ);
+
+			for (j = 0; j < NODE_LAG_BUCKETS; j++)
+				pg_atomic_init_u64(&slot->lag_hist[j], 0);
+		}
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+static void
+node_lag_check_loaded(void)
+{
+	if (!node_lag)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				errmsg("uuid_v1 node lag monitor must be loaded via shared_preload_libraries")));
+}
+
+/*
+ * node_lag_slot
+ *	Find or claim the slot of the given node using linear probing.
+ *
+ * Returns NULL if the table is full.
+ */
+static uuid_v1_node_lag_slot*
+node_lag_slot(const unsigned char *node)
+{
+	uint64 key = NODE_LAG_USED;
+	uint32 hash;
+	int i;
+
+	for (i = 0; i < UUID_NODE_LEN; i++)
+		key |= ((uint64) node[i]) << (8 * (UUID_NODE_LEN - 1 - i));
+
+	hash = DatumGetUInt32(hash_any(node, UUID_NODE_LEN));
+
+	for (i = 0; i < node_lag->nslots; i++)
+	{
+		uuid_v1_node_lag_slot *slot = &node_lag->slots[(hash + i) % node_lag->nslots];
+		uint64 current = pg_atomic_read_u64(&slot->node);
+
+		if (current == key)
+			return slot;
+
+		if (current == 0)
+		{
+			/* on failure, current holds the node that won the race */
+			if (pg_atomic_compare_exchange_u64(&slot->node, &current, key)
+					|| current == key)
+				return slot;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * node_lag_atomic_max
+ *	Atomically raise the given value to at least value.
+ *
+ * Returns false if the current value was already greater than value.
+ */
+static bool
+node_lag_atomic_max(pg_atomic_uint64 *ptr, uint64 value)
+{
+	uint64 current = pg_atomic_read_u64(ptr);
+
+	while (current < value)
+	{
+		if (pg_atomic_compare_exchange_u64(ptr, &current, value))
+			return true;
+	}
+
+	return current <= value;
+}
+
+static void
+node_lag_record(const pg_uuid_v1 *uuid, TimestampTz now)
+{
+	uuid_v1_node_lag_slot *slot;
+	int64 lag;
+	uint32 prev_clock_seq;
+	int bucket;
+
+	slot = node_lag_slot(uuid->node);
+	if (!slot)
+	{
+		pg_atomic_fetch_add_u64(&node_lag->overflow, 1);
+		return;
+	}
+
+	lag = now - uuid_v1_timestamptz(uuid);
+
+	if (lag < 0)
+	{
+		bucket = 0;
+		node_lag_atomic_max(&slot->max_ahead, (uint64) -lag);
+	}
+	else
+	{
+		for (bucket = 1; bucket < NODE_LAG_BUCKETS - 1; bucket++)
+		{
+			if (lag < node_lag_bounds[bucket - 1])
+				break;
+		}
+	}
+
+	pg_atomic_fetch_add_u64(&slot->rows, 1);
+	pg_atomic_fetch_add_u64(&slot->lag_hist[bucket], 1);
+	pg_atomic_write_u64(&slot->last_seen, (uint64) now);
+
+	if (!node_lag_atomic_max(&slot->newest, (uint64) uuid->timestamp))
+		pg_atomic_fetch_add_u64(&slot->late_rows, 1);
+
+	prev_clock_seq = pg_atomic_exchange_u32(&slot->clock_seq, (uint32) uuid->clock_seq);
+	if (prev_clock_seq != (uint32) uuid->clock_seq && prev_clock_seq != NODE_LAG_NO_CLOCKSEQ)
+		pg_atomic_fetch_add_u64(&slot->clock_seq_changes, 1);
+}
+
+/*
+ * uuid_v1_node_lag_trigger
+ *	Row trigger recording the UUID of the column given as first trigger
+ *	argument in the node lag monitor.
+ *
+ * Meant to be used as BEFORE INSERT trigger, which avoids queueing an after
+ * trigger event for each and every row.
+ */
+Datum
+uuid_v1_node_lag_trigger(PG_FUNCTION_ARGS)
+{
+	TriggerData *trigdata = (TriggerData *) fcinfo->context;
+	Relation rel;
+	HeapTuple tuple;
+	uuid_v1_node_lag_cache *cache;
+	Datum value;
+	bool isnull;
+
+	if (!CALLED_AS_TRIGGER(fcinfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+				errmsg("uuid_v1_node_lag_trigger: not called by trigger manager")));
+
+	if (!TRIGGER_FIRED_FOR_ROW(trigdata->tg_event) || !TRIGGER_FIRED_BY_INSERT(trigdata->tg_event))
+		ereport(ERROR,
+				(errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+				errmsg("uuid_v1_node_lag_trigger: must be fired for each row on INSERT")));
+
+	if (trigdata->tg_trigger->tgnargs != 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+				errmsg("uuid_v1_node_lag_trigger: expected the column name as single argument")));
+
+	node_lag_check_loaded();
+
+	rel = trigdata->tg_relation;
+	tuple = trigdata->tg_trigtuple;
+
+	cache = (uuid_v1_node_lag_cache *) fcinfo->flinfo->fn_extra;
+	if (cache == NULL || cache->relid != RelationGetRelid(rel))
+	{
+		int attnum = SPI_fnumber(rel->rd_att, trigdata->tg_trigger->tgargs[0]);
+
+		if (attnum <= 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_COLUMN),
+					errmsg("uuid_v1_node_lag_trigger: column \"%s\" does not exist",
+					trigdata->tg_trigger->tgargs[0])));
+
+		if (getBaseType(TupleDescAttr(rel->rd_att, attnum - 1)->atttypid) !=
+			uuid_v1_type_oid(fcinfo->flinfo->fn_oid))
+			ereport(ERROR,
+					(errcode(ERRCODE_DATATYPE_MISMATCH),
+					errmsg("uuid_v1_node_lag_trigger: column \"%s\" is not of type %s",
+					trigdata->tg_trigger->tgargs[0], "uuid_v1")));
+
+		if (cache == NULL)
+			cache = MemoryContextAlloc(fcinfo->flinfo->fn_mcxt, sizeof(uuid_v1_node_lag_cache));
+
+		cache->relid = RelationGetRelid(rel);
+		cache->attnum = attnum;
+		fcinfo->flinfo->fn_extra = cache;
+	}
+
+	value = heap_getattr(tuple, cache->attnum, rel->rd_att, &isnull);
+	if (!isnull)
+		node_lag_record(DatumGetUUIDV1P(value), GetCurrentTimestamp());
+
+	return PointerGetDatum(tuple);
+}
+
+/*
+ * uuid_v1_node_lag
+ *	Return the statistics of all tracked nodes.
+ */
+Datum
+uuid_v1_node_lag(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext oldcontext;
+	int i, j;
+
+	node_lag_check_loaded();
+
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				errmsg("materialize mode required, but it is not allowed in this context")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	for (i = 0; i < node_lag->nslots; i++)
+	{
+		uuid_v1_node_lag_slot *slot = &node_lag->slots[i];
+		Datum values[9];
+		bool nulls[9];
+		Datum hist[NODE_LAG_BUCKETS];
+		uint64 key = pg_atomic_read_u64(&slot->node);
+		uint64 newest;
+		uint32 clock_seq;
+		bytea *node;
+		Interval *ahead;
+		pg_uuid_v1 tmp;
+
+		if (key == 0)
+			continue;
+
+		memset(nulls, 0, sizeof(nulls));
+
+		node = palloc(UUID_NODE_LEN + VARHDRSZ);
+		SET_VARSIZE(node, UUID_NODE_LEN + VARHDRSZ);
+		for (j = 0; j < UUID_NODE_LEN; j++)
+			((unsigned char *) VARDATA(node))[j] = (key >> (8 * (UUID_NODE_LEN - 1 - j))) & 0xFF;
+
+		newest = pg_atomic_read_u64(&slot->newest);
+		tmp.timestamp = (int64) newest;
+
+		ahead = (Interval *) palloc0(sizeof(Interval));
+		ahead->time = (int64) pg_atomic_read_u64(&slot->max_ahead);
+
+		for (j = 0; j < NODE_LAG_BUCKETS; j++)
+			hist[j] = Int64GetDatum((int64) pg_atomic_read_u64(&slot->lag_hist[j]));
+
+		values[0] = PointerGetDatum(node);
+		values[1] = Int64GetDatum((int64) pg_atomic_read_u64(&slot->rows));
+		values[2] = Int64GetDatum((int64) pg_atomic_read_u64(&slot->late_rows));
+		values[3] = TimestampTzGetDatum((TimestampTz) pg_atomic_read_u64(&slot->last_seen));
+		values[4] = TimestampTzGetDatum(uuid_v1_timestamptz(&tmp));
+		values[5] = IntervalPGetDatum(ahead);
+
+		clock_seq = pg_atomic_read_u32(&slot->clock_seq);
+		if (clock_seq == NODE_LAG_NO_CLOCKSEQ)
+			nulls[6] = true;
+		else
+			values[6] = Int16GetDatum((int16) clock_seq);
+
+		values[7] = Int64GetDatum((int64) pg_atomic_read_u64(&slot->clock_seq_changes));
+		values[8] = PointerGetDatum(construct_array(hist, NODE_LAG_BUCKETS, INT8OID,
+													sizeof(int64), FLOAT8PASSBYVAL, 'd'));
+
+		/* the slot may have been claimed but not yet been written to */
+		if (newest == 0)
+		{
+			nulls[3] = true;
+			nulls[4] = true;
+		}
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	/* report rows we were not able to track with a NULL node */
+	if (pg_atomic_read_u64(&node_lag->overflow) > 0)
+	{
+		Datum values[9];
+		bool nulls[9];
+
+		memset(nulls, true, sizeof(nulls));
+		values[1] = Int64GetDatum((int64) pg_atomic_read_u64(&node_lag->overflow));
+		nulls[1] = false;
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	return (Datum) 0;
+}
+
+/*
+ * uuid_v1_node_lag_reset
+ *	Forget about all tracked nodes.
+ *
+ * Concurrent inserts may still add to the counters of a slot while it is
+ * being reset, which is acceptable for statistics like these.
+ */
+Datum
+uuid_v1_node_lag_reset(PG_FUNCTION_ARGS)
+{
+	int i, j;
+
+	node_lag_check_loaded();
+
+	for (i = 0; i < node_lag->nslots; i++)
+	{
+		uuid_v1_node_lag_slot *slot = &node_lag->slots[i];
+
+		pg_atomic_write_u64(&slot->rows, 0);
+		pg_atomic_write_u64(&slot->late_rows, 0);
+		pg_atomic_write_u64(&slot->newest, 0);
+		pg_atomic_write_u64(&slot->last_seen, 0);
+		pg_atomic_write_u64(&slot->max_ahead, 0);
+		pg_atomic_write_u64(&slot->clock_seq_changes, 0);
+		pg_atomic_write_u32(&slot->clock_seq, NODE_LAG_NO_CLOCKSEQ);
+
+		for (j = 0; j < NODE_LAG_BUCKETS; j++)
+			pg_atomic_write_u64(&slot->lag_hist[j], 0);
+
+		pg_atomic_write_u64(&slot->node, 0);
+	}
+
+	pg_atomic_write_u64(&node_lag->overflow, 0);
+
+	PG_RETURN_VOID();
+}
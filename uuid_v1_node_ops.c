@@ -0,0 +1,417 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * uuid_v1_node_ops.c
+ *	  Btree operator class uuid_v1_node_ops, ordering by node first.
+ *
+ * The order is by node (in byte order), then timestamp, then clock sequence,
+ * so an index using this operator class keeps the UUID's of each node
+ * together and in time order. The UUID's of a node are found by comparing
+ * against the node as bytea, ranges in time of a node by comparing against
+ * the smallest UUID of the node at a timestamp, see uuid_v1_node_lower().
+ *
+ * A node as bytea is equal to many UUID's, so the operators against bytea
+ * can't be members of the btree operator family. Instead, their support
+ * function turns them into index conditions against the smallest and largest
+ * UUID's of the node.
+ */
+#include "postgres.h"
+
+#include "access/stratnum.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_type.h"
+#include "datatype/timestamp.h"
+#include "fmgr.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "nodes/pathnodes.h"
+#include "nodes/supportnodes.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/sortsupport.h"
+#include "utils/timestamp.h"
+#include "utils/uuid.h"
+#include "uuid_v1.h"
+
+#if PG_VERSION_NUM >= 160000
+#include "varatt.h"
+#endif
+
+/* largest 60 bit UUID timestamp */
+#define NODE_OPS_MAX_TIMESTAMP ((INT64CONST(1) << 60) - 1)
+
+static int node_cmp0(const pg_uuid_v1 *a, const pg_uuid_v1 *b);
+static int node_cmp_bytea0(const pg_uuid_v1 *a, const bytea *node);
+static int node_sort_cmp(Datum x, Datum y, SortSupport ssup);
+static Datum node_abbrev_convert(Datum original, SortSupport ssup);
+static Expr *node_index_clause(Oid opfamily, Oid uuid_type, int strategy,
+		Node *uuid_arg, const bytea *node, bool upper);
+
+PG_FUNCTION_INFO_V1(uuid_v1_node_cmp);
+PG_FUNCTION_INFO_V1(uuid_v1_node_lt);
+PG_FUNCTION_INFO_V1(uuid_v1_node_le);
+PG_FUNCTION_INFO_V1(uuid_v1_node_gt);
+PG_FUNCTION_INFO_V1(uuid_v1_node_ge);
+
+PG_FUNCTION_INFO_V1(uuid_v1_node_eq_bytea);
+PG_FUNCTION_INFO_V1(uuid_v1_node_lt_bytea);
+PG_FUNCTION_INFO_V1(uuid_v1_node_le_bytea);
+PG_FUNCTION_INFO_V1(uuid_v1_node_gt_bytea);
+PG_FUNCTION_INFO_V1(uuid_v1_node_ge_bytea);
+
+PG_FUNCTION_INFO_V1(uuid_v1_node_sortsupport);
+PG_FUNCTION_INFO_V1(uuid_v1_node_support);
+PG_FUNCTION_INFO_V1(uuid_v1_node_lower);
+
+/*
+ * node_cmp0
+ *	Compare by node, then timestamp, then clock sequence.
+ */
+static int
+node_cmp0(const pg_uuid_v1 *a, const pg_uuid_v1 *b)
+{
+	int cmp = memcmp(a->node, b->node, UUID_NODE_LEN);
+
+	if (cmp != 0)
+		return cmp;
+
+	if (a->timestamp < b->timestamp)
+		return -1;
+	else if (a->timestamp > b->timestamp)
+		return 1;
+
+	if (a->clock_seq < b->clock_seq)
+		return -1;
+	else if (a->clock_seq > b->clock_seq)
+		return 1;
+
+	return 0;
+}
+
+/*
+ * node_cmp_bytea0
+ *	Compare the node of a UUID to a bytea, like byteacmp() would compare the
+ *	node as a bytea of UUID_NODE_LEN bytes.
+ */
+static int
+node_cmp_bytea0(const pg_uuid_v1 *a, const bytea *node)
+{
+	int len = VARSIZE_ANY_EXHDR(node);
+	int cmp = memcmp(a->node, VARDATA_ANY(node), Min(len, UUID_NODE_LEN));
+
+	if (cmp == 0 && len != UUID_NODE_LEN)
+		cmp = (UUID_NODE_LEN < len) ? -1 : 1;
+
+	return cmp;
+}
+
+Datum
+uuid_v1_node_cmp(PG_FUNCTION_ARGS)
+{
+	pg_uuid_v1 *a = PG_GETARG_UUIDV1_P(0);
+	pg_uuid_v1 *b = PG_GETARG_UUIDV1_P(1);
+
+	PG_RETURN_INT32(node_cmp0(a, b));
+}
+
+Datum
+uuid_v1_node_lt(PG_FUNCTION_ARGS)
+{
+	pg_uuid_v1 *a = PG_GETARG_UUIDV1_P(0);
+	pg_uuid_v1 *b = PG_GETARG_UUIDV1_P(1);
+
+	PG_RETURN_BOOL(node_cmp0(a, b) < 0);
+}
+
+Datum
+uuid_v1_node_le(PG_FUNCTION_ARGS)
+{
+	pg_uuid_v1 *a = PG_GETARG_UUIDV1_P(0);
+	pg_uuid_v1 *b = PG_GETARG_UUIDV1_P(1);
+
+	PG_RETURN_BOOL(node_cmp0(a, b) <= 0);
+}
+
+Datum
+uuid_v1_node_gt(PG_FUNCTION_ARGS)
+{
+	pg_uuid_v1 *a = PG_GETARG_UUIDV1_P(0);
+	pg_uuid_v1 *b = PG_GETARG_UUIDV1_P(1);
+
+	PG_RETURN_BOOL(node_cmp0(a, b) > 0);
+}
+
+Datum
+uuid_v1_node_ge(PG_FUNCTION_ARGS)
+{
+	pg_uuid_v1 *a = PG_GETARG_UUIDV1_P(0);
+	pg_uuid_v1 *b = PG_GETARG_UUIDV1_P(1);
+
+	PG_RETURN_BOOL(node_cmp0(a, b) >= 0);
+}
+
+Datum
+uuid_v1_node_eq_bytea(PG_FUNCTION_ARGS)
+{
+	pg_uuid_v1 *a = PG_GETARG_UUIDV1_P(0);
+	bytea *b = PG_GETARG_BYTEA_PP(1);
+
+	PG_RETURN_BOOL(node_cmp_bytea0(a, b) == 0);
+}
+
+Datum
+uuid_v1_node_lt_bytea(PG_FUNCTION_ARGS)
+{
+	pg_uuid_v1 *a = PG_GETARG_UUIDV1_P(0);
+	bytea *b = PG_GETARG_BYTEA_PP(1);
+
+	PG_RETURN_BOOL(node_cmp_bytea0(a, b) < 0);
+}
+
+Datum
+uuid_v1_node_le_bytea(PG_FUNCTION_ARGS)
+{
+	pg_uuid_v1 *a = PG_GETARG_UUIDV1_P(0);
+	bytea *b = PG_GETARG_BYTEA_PP(1);
+
+	PG_RETURN_BOOL(node_cmp_bytea0(a, b) <= 0);
+}
+
+Datum
+uuid_v1_node_gt_bytea(PG_FUNCTION_ARGS)
+{
+	pg_uuid_v1 *a = PG_GETARG_UUIDV1_P(0);
+	bytea *b = PG_GETARG_BYTEA_PP(1);
+
+	PG_RETURN_BOOL(node_cmp_bytea0(a, b) > 0);
+}
+
+Datum
+uuid_v1_node_ge_bytea(PG_FUNCTION_ARGS)
+{
+	pg_uuid_v1 *a = PG_GETARG_UUIDV1_P(0);
+	bytea *b = PG_GETARG_BYTEA_PP(1);
+
+	PG_RETURN_BOOL(node_cmp_bytea0(a, b) >= 0);
+}
+
+/*
+ * uuid_v1_node_sortsupport
+ *	Sort support strategy routine of uuid_v1_node_ops.
+ */
+Datum
+uuid_v1_node_sortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+
+	ssup->comparator = node_sort_cmp;
+	ssup->ssup_extra = NULL;
+
+	if (ssup->abbreviate)
+	{
+		uuid_v1_abbrev_init(ssup);
+
+		ssup->abbrev_converter = node_abbrev_convert;
+		ssup->abbrev_full_comparator = node_sort_cmp;
+	}
+
+	PG_RETURN_VOID();
+}
+
+static int
+node_sort_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	return node_cmp0(DatumGetUUIDV1P(x), DatumGetUUIDV1P(y));
+}
+
+/*
+ * node_abbrev_convert
+ *	Abbreviated key of a UUID in node order.
+ *
+ * The key is the node as a 48 bit big-endian integer, followed by the upper
+ * 16 bits of the 60 bit timestamp (about 20 days each), so UUID's of the same
+ * node only compare equal when they are close in time. With 4 byte Datums,
+ * only the first 4 bytes of the node are kept.
+ */
+static Datum
+node_abbrev_convert(Datum original, SortSupport ssup)
+{
+	pg_uuid_v1 *authoritative = DatumGetUUIDV1P(original);
+	int64 timestamp = authoritative->timestamp;
+	uint64 key = 0;
+	Datum res;
+	int i;
+
+	for (i = 0; i < UUID_NODE_LEN; i++)
+		key = (key << 8) | authoritative->node[i];
+
+	/* clamp, so keys of out-of-range timestamps still sort consistently */
+	if (timestamp < 0)
+		timestamp = 0;
+	else if (timestamp > NODE_OPS_MAX_TIMESTAMP)
+		timestamp = NODE_OPS_MAX_TIMESTAMP;
+
+	key = (key << 16) | (uint64) (timestamp >> 44);
+
+#if SIZEOF_DATUM == 8
+	res = (Datum) key;
+#else       /* SIZEOF_DATUM != 8 */
+	res = (Datum) (key >> 32);
+#endif
+
+	uuid_v1_abbrev_count(ssup, res);
+
+	return res;
+}
+
+/*
+ * node_index_clause
+ *	Index condition comparing against the smallest (or largest) UUID of the
+ *	node, using the operator of the given strategy of the operator family.
+ */
+static Expr *
+node_index_clause(Oid opfamily, Oid uuid_type, int strategy, Node *uuid_arg,
+				  const bytea *node, bool upper)
+{
+	pg_uuid_v1 *bound = (pg_uuid_v1 *) palloc(UUID_LEN);
+	Oid opno = get_opfamily_member(opfamily, uuid_type, uuid_type, strategy);
+
+	bound->timestamp = upper ? PG_INT64_MAX : PG_INT64_MIN;
+	bound->clock_seq = upper ? PG_INT16_MAX : PG_INT16_MIN;
+	memcpy(bound->node, VARDATA_ANY(node), UUID_NODE_LEN);
+
+	return make_opclause(opno, BOOLOID, false, (Expr *) uuid_arg,
+						 (Expr *) makeConst(uuid_type, -1, InvalidOid, UUID_LEN,
+											UUIDV1PGetDatum(bound), false, false),
+						 InvalidOid, InvalidOid);
+}
+
+/*
+ * uuid_v1_node_support
+ *	Planner support function of the operators comparing the node to a bytea.
+ *
+ * For an index using uuid_v1_node_ops and a constant node of UUID_NODE_LEN
+ * bytes, the comparison is turned into an exact condition against the
+ * smallest and/or largest UUID of the node, e.g. "id =# node" becomes
+ * "id >=# smallest AND id <=# largest".
+ */
+Datum
+uuid_v1_node_support(PG_FUNCTION_ARGS)
+{
+	Node *rawreq = (Node *) PG_GETARG_POINTER(0);
+	SupportRequestIndexCondition *req;
+	PGFunction fn;
+	FmgrInfo flinfo;
+	List *args;
+	Node *uuid_arg;
+	Const *node_arg;
+	const bytea *node;
+	Oid uuid_type;
+	Oid opno;
+	List *result;
+
+	if (!IsA(rawreq, SupportRequestIndexCondition))
+		PG_RETURN_POINTER(NULL);
+
+	req = (SupportRequestIndexCondition *) rawreq;
+
+	if (req->index->relam != BTREE_AM_OID || req->indexarg != 0)
+		PG_RETURN_POINTER(NULL);
+
+	if (is_opclause(req->node))
+		args = ((OpExpr *) req->node)->args;
+	else if (is_funcclause(req->node))
+		args = ((FuncExpr *) req->node)->args;
+	else
+		PG_RETURN_POINTER(NULL);
+
+	if (list_length(args) != 2 || !IsA(lsecond(args), Const))
+		PG_RETURN_POINTER(NULL);
+
+	uuid_arg = (Node *) linitial(args);
+	node_arg = (Const *) lsecond(args);
+
+	if (node_arg->constisnull)
+		PG_RETURN_POINTER(NULL);
+
+	node = DatumGetByteaPP(node_arg->constvalue);
+	if (VARSIZE_ANY_EXHDR(node) != UUID_NODE_LEN)
+		PG_RETURN_POINTER(NULL);
+
+	/* only indexes in node order */
+	uuid_type = exprType(uuid_arg);
+	opno = get_opfamily_member(req->opfamily, uuid_type, uuid_type,
+							   BTLessStrategyNumber);
+	if (!OidIsValid(opno))
+		PG_RETURN_POINTER(NULL);
+
+	fmgr_info(get_opcode(opno), &flinfo);
+	if (flinfo.fn_addr != uuid_v1_node_lt)
+		PG_RETURN_POINTER(NULL);
+
+	fmgr_info(req->funcid, &flinfo);
+	fn = flinfo.fn_addr;
+
+	if (fn == uuid_v1_node_eq_bytea)
+		result = list_make2(node_index_clause(req->opfamily, uuid_type, BTGreaterEqualStrategyNumber,
+											  uuid_arg, node, false),
+							node_index_clause(req->opfamily, uuid_type, BTLessEqualStrategyNumber,
+											  uuid_arg, node, true));
+	else if (fn == uuid_v1_node_lt_bytea)
+		result = list_make1(node_index_clause(req->opfamily, uuid_type, BTLessStrategyNumber,
+											  uuid_arg, node, false));
+	else if (fn == uuid_v1_node_le_bytea)
+		result = list_make1(node_index_clause(req->opfamily, uuid_type, BTLessEqualStrategyNumber,
+											  uuid_arg, node, true));
+	else if (fn == uuid_v1_node_gt_bytea)
+		result = list_make1(node_index_clause(req->opfamily, uuid_type, BTGreaterStrategyNumber,
+											  uuid_arg, node, true));
+	else if (fn == uuid_v1_node_ge_bytea)
+		result = list_make1(node_index_clause(req->opfamily, uuid_type, BTGreaterEqualStrategyNumber,
+											  uuid_arg, node, false));
+	else
+		PG_RETURN_POINTER(NULL);
+
+	req->lossy = false;
+
+	PG_RETURN_POINTER(result);
+}
+
+/*
+ * uuid_v1_node_lower
+ *	Smallest UUID of a node at a timestamp, the bound of time ranges of a
+ *	node in uuid_v1_node_ops order.
+ */
+Datum
+uuid_v1_node_lower(PG_FUNCTION_ARGS)
+{
+	bytea *node = PG_GETARG_BYTEA_PP(0);
+	TimestampTz ts = PG_GETARG_TIMESTAMPTZ(1);
+	pg_uuid_v1 *uuid;
+
+	if (VARSIZE_ANY_EXHDR(node) != UUID_NODE_LEN)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				errmsg("node must be %d bytes long", UUID_NODE_LEN)));
+
+	if (!uuid_timestamp_in_range(ts))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+				errmsg("timestamp out of range")));
+
+	uuid = (pg_uuid_v1 *) palloc0(UUID_LEN);
+	uuid->timestamp = to_uuid_timestamp(ts);
+	memcpy(uuid->node, VARDATA_ANY(node), UUID_NODE_LEN);
+
+	PG_RETURN_UUIDV1_P(uuid);
+}
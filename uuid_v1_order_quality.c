@@ -0,0 +1,540 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * uuid_v1_order_quality.c
+ *	  Report on how well the physical order of a table or index follows time.
+ *
+ * Time ordered keys are only appended at the end of the heap and the btree
+ * as long as they arrive in order. Late arrivals and clock skew spread the
+ * inserts instead, which shows up as rows older than rows stored before
+ * them in the heap, and as leaf pages split in the middle of the index,
+ * whose right sibling then lies physically before them. The report reads the
+ * relation in physical order using a bulk read strategy, either completely
+ * or a sample of its blocks chosen like ANALYZE does.
+ */
+#include <math.h>
+
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "access/nbtree.h"
+#include "access/relscan.h"
+#include "access/table.h"
+#include "access/tableam.h"
+#include "catalog/index.h"
+#include "catalog/objectaddress.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_class.h"
+#include "commands/defrem.h"
+#include "executor/tuptable.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+#include "storage/bufpage.h"
+#include "utils/acl.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+#include "utils/sampling.h"
+#include "utils/snapmgr.h"
+#include "utils/timestamp.h"
+#include "utils/tuplestore.h"
+#include "utils/uuid.h"
+#include "uuid_v1.h"
+
+/* number of blocks read in sampled mode */
+#define ORDER_QUALITY_SAMPLE_BLOCKS	10000
+
+#define ORDER_QUALITY_COLUMNS		9
+
+typedef struct uuid_v1_order_quality_stats
+{
+	unsigned char node[UUID_NODE_LEN];	/* hash key */
+	int64 rows;
+	int64 out_of_order;		/* rows older than a row stored before them */
+	int64 max_ts;			/* newest UUID timestamp seen so far */
+	int64 max_lateness;		/* in ticks */
+	/* running moments for the correlation of position and timestamp */
+	double n;
+	double mean_x;
+	double mean_y;
+	double m2_x;
+	double m2_y;
+	double c_xy;
+} uuid_v1_order_quality_stats;
+
+static void order_quality_correlate(uuid_v1_order_quality_stats *stats, double x, double y);
+static void order_quality_add_row(uuid_v1_order_quality_stats *stats, double x, int64 ts);
+static void order_quality_rows(TableScanDesc scan, TupleTableSlot *slot,
+							   AttrNumber attnum, uuid_v1_order_quality_stats *total,
+							   HTAB *nodes);
+static void order_quality_table(Relation rel, AttrNumber attnum, bool exact,
+								uuid_v1_order_quality_stats *total, HTAB *nodes,
+								int64 *pages);
+static void order_quality_index(Relation index, bool exact,
+								uuid_v1_order_quality_stats *total,
+								int64 *pages, double *fill);
+static int order_quality_node_cmp(const void *a, const void *b);
+
+PG_FUNCTION_INFO_V1(uuid_v1_order_quality);
+
+/*
+ * order_quality_correlate
+ *	Add a point to the running moments, using Welford's algorithm to avoid
+ *	the loss of precision of summing up squares of large timestamps.
+ */
+static void
+order_quality_correlate(uuid_v1_order_quality_stats *stats, double x, double y)
+{
+	double dx;
+	double dy;
+
+	stats->n += 1.0;
+	dx = x - stats->mean_x;
+	dy = y - stats->mean_y;
+	stats->mean_x += dx / stats->n;
+	stats->mean_y += dy / stats->n;
+	stats->m2_x += dx * (x - stats->mean_x);
+	stats->m2_y += dy * (y - stats->mean_y);
+	stats->c_xy += dx * (y - stats->mean_y);
+}
+
+static void
+order_quality_add_row(uuid_v1_order_quality_stats *stats, double x, int64 ts)
+{
+	if (stats->rows > 0 && ts < stats->max_ts)
+	{
+		stats->out_of_order++;
+		stats->max_lateness = Max(stats->max_lateness, stats->max_ts - ts);
+	}
+	else
+		stats->max_ts = ts;
+
+	stats->rows++;
+	order_quality_correlate(stats, x, (double) ts);
+}
+
+/*
+ * order_quality_rows
+ *	Add all rows returned by the scan to the totals and the node statistics.
+ */
+static void
+order_quality_rows(TableScanDesc scan, TupleTableSlot *slot, AttrNumber attnum,
+				   uuid_v1_order_quality_stats *total, HTAB *nodes)
+{
+	while (table_scan_getnextslot(scan, ForwardScanDirection, slot))
+	{
+		uuid_v1_order_quality_stats *stats;
+		pg_uuid_v1 *uuid;
+		bool isnull;
+		bool found;
+		Datum value;
+		double x;
+
+		CHECK_FOR_INTERRUPTS();
+
+		value = slot_getattr(slot, attnum, &isnull);
+		if (isnull)
+			continue;
+
+		uuid = DatumGetUUIDV1P(value);
+
+		/* physical position of the row */
+		x = (double) ItemPointerGetBlockNumber(&slot->tts_tid) * MaxHeapTuplesPerPage +
+			ItemPointerGetOffsetNumber(&slot->tts_tid);
+
+		order_quality_add_row(total, x, uuid->timestamp);
+
+		stats = hash_search(nodes, uuid->node, HASH_ENTER, &found);
+		if (!found)
+			memset((char *) stats + UUID_NODE_LEN, 0,
+				   sizeof(uuid_v1_order_quality_stats) - UUID_NODE_LEN);
+
+		order_quality_add_row(stats, x, uuid->timestamp);
+	}
+}
+
+/*
+ * order_quality_table
+ *	Read the rows of a heap table in physical order, all of them or those of
+ *	a sample of blocks.
+ *
+ * Synchronized scans are disabled, as they would start in the middle of the
+ * table.
+ */
+static void
+order_quality_table(Relation rel, AttrNumber attnum, bool exact,
+					uuid_v1_order_quality_stats *total, HTAB *nodes,
+					int64 *pages)
+{
+	TableScanDesc scan;
+	TupleTableSlot *slot;
+	BlockNumber nblocks;
+
+	scan = table_beginscan_strat(rel, GetActiveSnapshot(), 0, NULL, true, false);
+	slot = table_slot_create(rel, NULL);
+	nblocks = ((HeapScanDesc) scan)->rs_nblocks;
+
+	if (exact)
+	{
+		*pages = nblocks;
+		order_quality_rows(scan, slot, attnum, total, nodes);
+	}
+	else
+	{
+		BlockSamplerData sampler;
+
+		*pages = 0;
+		BlockSampler_Init(&sampler, nblocks, ORDER_QUALITY_SAMPLE_BLOCKS, 0);
+
+		while (BlockSampler_HasMore(&sampler))
+		{
+			table_rescan(scan, NULL);
+			heap_setscanlimits(scan, BlockSampler_Next(&sampler), 1);
+			(*pages)++;
+
+			order_quality_rows(scan, slot, attnum, total, nodes);
+		}
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	table_endscan(scan);
+}
+
+/*
+ * order_quality_index
+ *	Read the leaf pages of a btree index in physical order, all of them or a
+ *	sample.
+ *
+ * Each leaf page contributes its fill and the first key on it, which is
+ * correlated with its block number. Leaf pages whose right sibling lies
+ * physically before them are counted as out of order.
+ */
+static void
+order_quality_index(Relation index, bool exact,
+					uuid_v1_order_quality_stats *total,
+					int64 *pages, double *fill)
+{
+	BufferAccessStrategy strategy = GetAccessStrategy(BAS_BULKREAD);
+	BlockNumber nblocks = RelationGetNumberOfBlocks(index);
+	BlockSamplerData sampler;
+	BlockNumber blkno = BTREE_METAPAGE;
+
+	/* skip the metapage */
+	if (!exact && nblocks > 1)
+		BlockSampler_Init(&sampler, nblocks - 1, ORDER_QUALITY_SAMPLE_BLOCKS, 0);
+
+	*pages = 0;
+	*fill = 0.0;
+
+	for (;;)
+	{
+		Buffer buf;
+		Page page;
+		BTPageOpaque opaque;
+
+		if (exact)
+		{
+			if (++blkno >= nblocks)
+				break;
+		}
+		else
+		{
+			if (nblocks <= 1 || !BlockSampler_HasMore(&sampler))
+				break;
+			blkno = BlockSampler_Next(&sampler) + 1;
+		}
+
+		CHECK_FOR_INTERRUPTS();
+
+		buf = ReadBufferExtended(index, MAIN_FORKNUM, blkno, RBM_NORMAL, strategy);
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buf);
+
+		if (PageIsNew(page) ||
+			PageGetSpecialSize(page) != MAXALIGN(sizeof(BTPageOpaqueData)))
+		{
+			UnlockReleaseBuffer(buf);
+			continue;
+		}
+
+		opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+
+		if (P_ISLEAF(opaque) && !P_IGNORE(opaque))
+		{
+			Size usable = ((PageHeader) page)->pd_special - SizeOfPageHeaderData;
+			OffsetNumber first = P_FIRSTDATAKEY(opaque);
+
+			(*pages)++;
+			*fill += 1.0 - (double) PageGetExactFreeSpace(page) / (double) usable;
+
+			if (!P_RIGHTMOST(opaque) && opaque->btpo_next < blkno)
+				total->out_of_order++;
+
+			if (first <= PageGetMaxOffsetNumber(page))
+			{
+				IndexTuple itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, first));
+				bool isnull;
+				Datum value = index_getattr(itup, 1, RelationGetDescr(index), &isnull);
+
+				if (!isnull)
+					order_quality_correlate(total, (double) blkno,
+											(double) DatumGetUUIDV1P(value)->timestamp);
+			}
+		}
+
+		UnlockReleaseBuffer(buf);
+	}
+
+	FreeAccessStrategy(strategy);
+
+	if (*pages > 0)
+		*fill /= (double) *pages;
+}
+
+static int
+order_quality_node_cmp(const void *a, const void *b)
+{
+	return memcmp(((const uuid_v1_order_quality_stats *) a)->node,
+				  ((const uuid_v1_order_quality_stats *) b)->node, UUID_NODE_LEN);
+}
+
+/*
+ * uuid_v1_order_quality
+ *	Report on the physical order of a table or a btree index on a uuid_v1
+ *	column.
+ *
+ * For tables, the first uuid_v1 column is used. The first row returned holds
+ * the totals (with a NULL node), tables add a row per node. Unless exact is
+ * set, only a sample of the blocks is read.
+ */
+Datum
+uuid_v1_order_quality(PG_FUNCTION_ARGS)
+{
+	Oid relid = PG_GETARG_OID(0);
+	bool exact = PG_GETARG_BOOL(1);
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Oid typoid = uuid_v1_type_oid(fcinfo->flinfo->fn_oid);
+	TupleDesc tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext oldcontext;
+	Relation rel;
+	Oid tableid;
+	AclResult aclresult;
+	uuid_v1_order_quality_stats total;
+	HTAB *nodes = NULL;
+	int64 pages = 0;
+	double fill = 0.0;
+	bool is_index;
+	Datum values[ORDER_QUALITY_COLUMNS];
+	bool nulls[ORDER_QUALITY_COLUMNS];
+
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				errmsg("materialize mode required, but it is not allowed in this context")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	rel = relation_open(relid, AccessShareLock);
+	is_index = rel->rd_rel->relkind == RELKIND_INDEX;
+
+	if (!is_index && rel->rd_rel->relkind != RELKIND_RELATION &&
+		rel->rd_rel->relkind != RELKIND_MATVIEW)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				errmsg("\"%s\" is not a table or index",
+					   RelationGetRelationName(rel))));
+
+	/* reading the rows requires the privilege to select from the table */
+	tableid = is_index ? IndexGetRelation(relid, false) : relid;
+	aclresult = pg_class_aclcheck(tableid, GetUserId(), ACL_SELECT);
+	if (aclresult != ACLCHECK_OK)
+		aclcheck_error(aclresult, get_relkind_objtype(get_rel_relkind(tableid)),
+					   get_rel_name(tableid));
+
+	memset(&total, 0, sizeof(total));
+
+	if (is_index)
+	{
+		/* other operator classes don't keep the leaf pages in time order */
+		if (rel->rd_rel->relam != BTREE_AM_OID ||
+			TupleDescAttr(RelationGetDescr(rel), 0)->atttypid != typoid ||
+			rel->rd_opfamily[0] != get_opclass_family(GetDefaultOpClass(typoid, BTREE_AM_OID)))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					errmsg("index \"%s\" is not a btree index with a leading uuid_v1 column using operator class uuid_v1_ops",
+						   RelationGetRelationName(rel))));
+
+		order_quality_index(rel, exact, &total, &pages, &fill);
+	}
+	else
+	{
+		AttrNumber attnum = InvalidAttrNumber;
+		HASHCTL info;
+		int i;
+
+		if (rel->rd_rel->relam != HEAP_TABLE_AM_OID)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					errmsg("table \"%s\" does not use the heap access method",
+						   RelationGetRelationName(rel))));
+
+		for (i = 0; i < RelationGetDescr(rel)->natts; i++)
+		{
+			Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(rel), i);
+
+			if (!attr->attisdropped && attr->atttypid == typoid)
+			{
+				attnum = attr->attnum;
+				break;
+			}
+		}
+
+		if (attnum == InvalidAttrNumber)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					errmsg("relation \"%s\" has no uuid_v1 column",
+						   RelationGetRelationName(rel))));
+
+		memset(&info, 0, sizeof(info));
+		info.keysize = UUID_NODE_LEN;
+		info.entrysize = sizeof(uuid_v1_order_quality_stats);
+		info.hcxt = CurrentMemoryContext;
+		nodes = hash_create("uuid_v1 order quality nodes", 64, &info,
+							HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+		order_quality_table(rel, attnum, exact, &total, nodes, &pages);
+	}
+
+	oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/* totals, where indexes are counted in leaf pages instead of rows */
+	memset(values, 0, sizeof(values));
+	memset(nulls, true, sizeof(nulls));
+
+	values[1] = Int64GetDatum(pages);
+	nulls[1] = false;
+	values[3] = Int64GetDatum(total.out_of_order);
+	nulls[3] = false;
+
+	if (is_index)
+	{
+		if (pages > 0)
+		{
+			values[4] = Float8GetDatum((double) total.out_of_order / (double) pages);
+			nulls[4] = false;
+			values[7] = Float8GetDatum(fill);
+			nulls[7] = false;
+		}
+	}
+	else
+	{
+		Interval *lateness = (Interval *) palloc0(sizeof(Interval));
+
+		lateness->time = total.max_lateness / 10;
+
+		values[2] = Int64GetDatum(total.rows);
+		nulls[2] = false;
+		values[5] = IntervalPGetDatum(lateness);
+		nulls[5] = false;
+
+		if (total.rows > 0)
+		{
+			values[4] = Float8GetDatum((double) total.out_of_order / (double) total.rows);
+			nulls[4] = false;
+		}
+	}
+
+	/* CLUSTER would turn the random part of index scans into sequential I/O */
+	if (total.m2_x > 0.0 && total.m2_y > 0.0)
+	{
+		double correlation = total.c_xy / sqrt(total.m2_x * total.m2_y);
+
+		values[6] = Float8GetDatum(correlation);
+		nulls[6] = false;
+		values[8] = Float8GetDatum(1.0 - correlation * correlation);
+		nulls[8] = false;
+	}
+
+	tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+
+	if (nodes != NULL)
+	{
+		long count = hash_get_num_entries(nodes);
+		uuid_v1_order_quality_stats *sorted;
+		uuid_v1_order_quality_stats *stats;
+		HASH_SEQ_STATUS status;
+		long i = 0;
+
+		sorted = palloc(sizeof(uuid_v1_order_quality_stats) * Max(count, 1));
+
+		hash_seq_init(&status, nodes);
+		while ((stats = hash_seq_search(&status)) != NULL)
+			sorted[i++] = *stats;
+
+		qsort(sorted, count, sizeof(uuid_v1_order_quality_stats), order_quality_node_cmp);
+
+		for (i = 0; i < count; i++)
+		{
+			bytea *node = palloc(UUID_NODE_LEN + VARHDRSZ);
+			Interval *lateness = (Interval *) palloc0(sizeof(Interval));
+
+			stats = &sorted[i];
+
+			SET_VARSIZE(node, UUID_NODE_LEN + VARHDRSZ);
+			memcpy(VARDATA(node), stats->node, UUID_NODE_LEN);
+			lateness->time = stats->max_lateness / 10;
+
+			memset(nulls, true, sizeof(nulls));
+
+			values[0] = PointerGetDatum(node);
+			nulls[0] = false;
+			values[2] = Int64GetDatum(stats->rows);
+			nulls[2] = false;
+			values[3] = Int64GetDatum(stats->out_of_order);
+			nulls[3] = false;
+			values[4] = Float8GetDatum((double) stats->out_of_order / (double) stats->rows);
+			nulls[4] = false;
+			values[5] = IntervalPGetDatum(lateness);
+			nulls[5] = false;
+
+			if (stats->m2_x > 0.0 && stats->m2_y > 0.0)
+			{
+				values[6] = Float8GetDatum(stats->c_xy / sqrt(stats->m2_x * stats->m2_y));
+				nulls[6] = false;
+			}
+
+			tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+		}
+
+		hash_destroy(nodes);
+	}
+
+	relation_close(rel, AccessShareLock);
+
+	return (Datum) 0;
+}
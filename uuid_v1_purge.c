@@ -0,0 +1,277 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * uuid_v1_purge.c
+ *	  Batched retention purge of rows by the timestamp of their uuid_v1 key.
+ *
+ * Rows are deleted in primary key order in batches of bounded size, each in
+ * its own transaction. Every batch starts its index scan at the last key
+ * deleted by the previous one, so it neither has to skip over the dead index
+ * entries left behind by earlier batches nor rescan the front of the index.
+ */
+#include "postgres.h"
+
+#include "access/table.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_index.h"
+#include "catalog/pg_type.h"
+#include "commands/defrem.h"
+#include "executor/spi.h"
+#include "fmgr.h"
+#include "lib/stringinfo.h"
+#include "miscadmin.h"
+#include "nodes/parsenodes.h"
+#include "pgstat.h"
+#include "storage/latch.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+#include "utils/relcache.h"
+#include "utils/syscache.h"
+#include "utils/timestamp.h"
+#include "utils/uuid.h"
+#include "uuid_v1.h"
+
+static char *purge_key_column(Oid relid, Oid typoid);
+
+PG_FUNCTION_INFO_V1(uuid_v1_purge_before);
+
+/*
+ * purge_key_column
+ *	Name of the primary key column, which must be a single uuid_v1 column
+ *	indexed using the default (time ordered) operator class.
+ */
+static char*
+purge_key_column(Oid relid, Oid typoid)
+{
+	Relation rel = table_open(relid, AccessShareLock);
+	Oid indexoid;
+	HeapTuple tuple;
+	Form_pg_index index;
+	Datum indclass;
+	bool isnull;
+	AttrNumber attnum;
+	Oid opclass;
+	char *column = NULL;
+
+#if PG_VERSION_NUM >= 180000
+	indexoid = RelationGetPrimaryKeyIndex(rel, false);
+#else
+	indexoid = RelationGetPrimaryKeyIndex(rel);
+#endif
+
+	if (!OidIsValid(indexoid))
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				errmsg("relation \"%s\" has no primary key",
+					   RelationGetRelationName(rel))));
+
+	tuple = SearchSysCache1(INDEXRELID, ObjectIdGetDatum(indexoid));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for index %u", indexoid);
+
+	index = (Form_pg_index) GETSTRUCT(tuple);
+	indclass = SysCacheGetAttr(INDEXRELID, tuple, Anum_pg_index_indclass, &isnull);
+	Assert(!isnull);
+
+	attnum = index->indkey.values[0];
+	opclass = ((oidvector *) DatumGetPointer(indclass))->values[0];
+
+	if (index->indnatts == 1 && attnum > 0 &&
+		TupleDescAttr(rel->rd_att, attnum - 1)->atttypid == typoid &&
+		opclass == GetDefaultOpClass(typoid, BTREE_AM_OID))
+		column = get_attname(relid, attnum, false);
+
+	ReleaseSysCache(tuple);
+
+	if (column == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				errmsg("primary key of relation \"%s\" must be a single uuid_v1 column using operator class uuid_v1_ops",
+					   RelationGetRelationName(rel))));
+
+	table_close(rel, AccessShareLock);
+
+	return column;
+}
+
+/*
+ * uuid_v1_purge_before
+ *	Delete all rows whose primary key is older than the given timestamp.
+ *
+ * Arguments are the relation, the cutoff timestamp, the maximum number of
+ * rows deleted per transaction and the maximum rate in rows per second (zero
+ * for no limit). The procedure commits after each batch, so it cannot be
+ * called within a transaction block.
+ */
+Datum
+uuid_v1_purge_before(PG_FUNCTION_ARGS)
+{
+	Oid relid;
+	TimestampTz cutoff;
+	int32 batch_size;
+	float8 max_rate;
+	CallContext *context = (CallContext *) fcinfo->context;
+	Oid typoid = uuid_v1_type_oid(fcinfo->flinfo->fn_oid);
+	const char *nspname;
+	char *relname;
+	const char *column;
+	StringInfoData query;
+	Oid argtypes[3];
+	Datum values[3];
+	SPIPlanPtr plan;
+	pg_uuid_v1 last_key;
+	TimestampTz start;
+	int64 total = 0;
+	int64 batches = 0;
+	double elapsed;
+
+	if (context == NULL || !IsA(context, CallContext) || context->atomic)
+		ereport(ERROR,
+				(errcode(ERRCODE_ACTIVE_SQL_TRANSACTION),
+				errmsg("uuid_v1_purge_before cannot run inside a transaction block")));
+
+	/* procedures can't be declared strict */
+	if (PG_ARGISNULL(0) || PG_ARGISNULL(1) || PG_ARGISNULL(2) || PG_ARGISNULL(3))
+		ereport(ERROR,
+				(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+				errmsg("arguments must not be null")));
+
+	relid = PG_GETARG_OID(0);
+	cutoff = PG_GETARG_TIMESTAMPTZ(1);
+	batch_size = PG_GETARG_INT32(2);
+	max_rate = PG_GETARG_FLOAT8(3);
+
+	if (batch_size < 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				errmsg("batch_size must be greater than zero")));
+
+	if (!(max_rate >= 0.0))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				errmsg("max_rate must not be negative")));
+
+	column = quote_identifier(purge_key_column(relid, typoid));
+	relname = quote_qualified_identifier(get_namespace_name(get_rel_namespace(relid)),
+										 get_rel_name(relid));
+	nspname = quote_identifier(get_namespace_name(get_func_namespace(fcinfo->flinfo->fn_oid)));
+
+	/*
+	 * The inner query walks the primary key index from the last deleted key,
+	 * the outer one deletes the rows found by their physical location. The
+	 * operators are qualified, as the extension might not be in search_path.
+	 */
+	initStringInfo(&query);
+	appendStringInfo(&query,
+					 "DELETE FROM %s WHERE ctid = ANY (ARRAY("
+					 "SELECT ctid FROM %s WHERE %s OPERATOR(%s.>=) $1 AND %s OPERATOR(%s.<~) $2 "
+					 "ORDER BY %s LIMIT $3)) RETURNING %s",
+					 relname, relname, column, nspname, column, nspname, column, column);
+
+	argtypes[0] = typoid;
+	argtypes[1] = TIMESTAMPTZOID;
+	argtypes[2] = INT4OID;
+
+	/* the smallest possible key */
+	memset(&last_key, 0, sizeof(last_key));
+
+	SPI_connect_ext(SPI_OPT_NONATOMIC);
+
+	plan = SPI_prepare(query.data, 3, argtypes);
+	if (plan == NULL)
+		elog(ERROR, "SPI_prepare failed for \"%s\": %s",
+			 query.data, SPI_result_code_string(SPI_result));
+
+	SPI_keepplan(plan);
+
+	start = GetCurrentTimestamp();
+
+	for (;;)
+	{
+		uint64 processed;
+		uint64 i;
+		int ret;
+
+		CHECK_FOR_INTERRUPTS();
+
+		values[0] = UUIDV1PGetDatum(&last_key);
+		values[1] = TimestampTzGetDatum(cutoff);
+		values[2] = Int32GetDatum(batch_size);
+
+		ret = SPI_execute_plan(plan, values, NULL, false, 0);
+		if (ret != SPI_OK_DELETE_RETURNING)
+			elog(ERROR, "SPI_execute_plan failed: %s", SPI_result_code_string(ret));
+
+		processed = SPI_processed;
+
+		/* RETURNING does not guarantee any order, so look for the largest key */
+		for (i = 0; i < processed; i++)
+		{
+			bool isnull;
+			Datum value = SPI_getbinval(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 1, &isnull);
+
+			if (!isnull && uuid_v1_cmp0(DatumGetUUIDV1P(value), &last_key) > 0)
+				memcpy(&last_key, DatumGetUUIDV1P(value), sizeof(last_key));
+		}
+
+		SPI_freetuptable(SPI_tuptable);
+		SPI_commit();
+#if PG_VERSION_NUM < 150000
+		SPI_start_transaction();
+#endif
+
+		if (processed == 0)
+			break;
+
+		total += processed;
+		batches++;
+
+		if (processed < (uint64) batch_size)
+			break;
+
+		/* sleep until the average rate is back at the limit */
+		if (max_rate > 0.0)
+		{
+			long secs;
+			int usecs;
+			double ahead;
+
+			TimestampDifference(start, GetCurrentTimestamp(), &secs, &usecs);
+			ahead = (double) total / max_rate - ((double) secs + (double) usecs / 1000000.0);
+
+			if (ahead > 0.0)
+			{
+				(void) WaitLatch(MyLatch,
+								 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+								 (long) (ahead * 1000.0),
+								 PG_WAIT_EXTENSION);
+				ResetLatch(MyLatch);
+			}
+		}
+	}
+
+	SPI_freeplan(plan);
+	SPI_finish();
+
+	elapsed = (double) (GetCurrentTimestamp() - start) / 1000000.0;
+
+	ereport(NOTICE,
+			(errmsg_plural("deleted %lld row", "deleted %lld rows", total,
+						   (long long) total),
+			errdetail("Batches: %lld, elapsed time: %.3f s, %.0f rows per second.",
+					  (long long) batches, elapsed,
+					  elapsed > 0.0 ? (double) total / elapsed : 0.0)));
+
+	PG_RETURN_VOID();
+}
@@ -0,0 +1,293 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * uuid_v1_read_binary.c
+ *	  Bulk loader for files of UUID's in their 16 byte binary form.
+ *
+ * The requested records of the file are read in chunks and converted into a
+ * buffer of pg_uuid_v1 values, validating version and variant the same way as
+ * uuid_v1_convert(uuid[]) does. The values are returned as pointers into the
+ * buffer, which stay valid until the next chunk is converted, so there is
+ * neither text conversion nor an allocation per row.
+ *
+ * The file is read with pread() rather than memory mapped: a mapped file
+ * being truncated by another process while it is read would kill the backend
+ * with SIGBUS, and with it the whole cluster would be restarted. A truncated
+ * file is reported as an error instead.
+ *
+ * The function returns one value per call, so called in a target list the
+ * memory used is bounded by the chunk size however large the file is. In a
+ * FROM clause the executor collects all values in a tuplestore first.
+ */
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "postgres.h"
+
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "storage/fd.h"
+#include "utils/builtins.h"
+#include "utils/uuid.h"
+#include "uuid_v1.h"
+
+/* number of records converted at once */
+#define READ_BINARY_CHUNK	8192
+
+/* the open file, closed at the latest when its context goes away */
+typedef struct read_binary_file
+{
+	MemoryContextCallback callback;
+	int fd;					/* -1 once closed */
+} read_binary_file;
+
+typedef struct uuid_v1_read_binary_state
+{
+	char *filename;
+	read_binary_file *file;	/* NULL if nothing is read */
+	int64 offset;			/* record number of the first requested record */
+	int64 next;				/* next record to convert, relative to offset */
+	int64 count;			/* number of requested records */
+	int64 current;			/* record being converted, for error context */
+	bool skip_invalid;
+	int nchunk;				/* number of values in the chunk */
+	int pos;				/* next value of the chunk to return */
+	pg_uuid_v1 chunk[READ_BINARY_CHUNK];
+	char raw[READ_BINARY_CHUNK * UUID_LEN];	/* records as read */
+} uuid_v1_read_binary_state;
+
+static void read_binary_open(uuid_v1_read_binary_state *state, MemoryContext context);
+static void read_binary_chunk(uuid_v1_read_binary_state *state);
+static void read_binary_close(void *arg);
+static void read_binary_error_callback(void *arg);
+
+PG_FUNCTION_INFO_V1(uuid_v1_read_binary);
+
+/*
+ * read_binary_open
+ *	Open the file and determine the number of records to read. Unless it is
+ *	closed before, the file is closed along with the given memory context,
+ *	e.g. when the scan is not run to completion.
+ *
+ * The file is not opened as a transient file, as those are closed at the end
+ * of the transaction before the memory context goes away.
+ */
+static void
+read_binary_open(uuid_v1_read_binary_state *state, MemoryContext context)
+{
+	read_binary_file *file;
+	struct stat st;
+	int64 nrecords;
+	int fd;
+
+	fd = BasicOpenFile(state->filename, O_RDONLY | PG_BINARY);
+	if (fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				errmsg("could not open file \"%s\" for reading: %m", state->filename)));
+
+	file = MemoryContextAllocZero(context, sizeof(read_binary_file));
+	file->fd = fd;
+	file->callback.func = read_binary_close;
+	file->callback.arg = file;
+	MemoryContextRegisterResetCallback(context, &file->callback);
+
+	if (fstat(fd, &st) < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				errmsg("could not stat file \"%s\": %m", state->filename)));
+
+	if (st.st_size % UUID_LEN != 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				errmsg("size of file \"%s\" is not a multiple of %d bytes",
+					   state->filename, UUID_LEN)));
+
+	nrecords = st.st_size / UUID_LEN;
+
+	if (state->offset >= nrecords)
+		state->count = 0;
+	else if (state->count < 0 || state->count > nrecords - state->offset)
+		state->count = nrecords - state->offset;
+
+	if (state->count == 0)
+	{
+		read_binary_close(file);
+		return;
+	}
+
+	(void) posix_fadvise(fd, (off_t) state->offset * UUID_LEN,
+						 (off_t) state->count * UUID_LEN, POSIX_FADV_SEQUENTIAL);
+
+	state->file = file;
+}
+
+/*
+ * read_binary_chunk
+ *	Convert the next chunk of records, dropping invalid ones if requested.
+ */
+static void
+read_binary_chunk(uuid_v1_read_binary_state *state)
+{
+	ErrorContextCallback errcallback;
+	const char *src = state->raw;
+	int n = (int) Min(READ_BINARY_CHUNK, state->count - state->next);
+	size_t size = (size_t) n * UUID_LEN;
+	size_t done = 0;
+	off_t start = (off_t) (state->offset + state->next) * UUID_LEN;
+	int i;
+
+	CHECK_FOR_INTERRUPTS();
+
+	while (done < size)
+	{
+		ssize_t nread = pread(state->file->fd, state->raw + done, size - done,
+							  start + (off_t) done);
+
+		if (nread < 0 && errno == EINTR)
+			continue;
+
+		if (nread < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					errmsg("could not read file \"%s\": %m", state->filename)));
+
+		if (nread == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					errmsg("file \"%s\" was truncated while being read",
+						   state->filename)));
+
+		done += nread;
+	}
+
+	errcallback.callback = read_binary_error_callback;
+	errcallback.arg = state;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	state->nchunk = 0;
+
+	for (i = 0; i < n; i++, src += UUID_LEN)
+	{
+		state->current = state->offset + state->next + i;
+
+		if (uuid_v1_array_from_std(src, (char *) &state->chunk[state->nchunk], state->skip_invalid))
+			state->nchunk++;
+	}
+
+	error_context_stack = errcallback.previous;
+
+	state->next += n;
+	state->pos = 0;
+}
+
+static void
+read_binary_close(void *arg)
+{
+	read_binary_file *file = (read_binary_file *) arg;
+
+	if (file->fd >= 0)
+		close(file->fd);
+
+	file->fd = -1;
+}
+
+static void
+read_binary_error_callback(void *arg)
+{
+	uuid_v1_read_binary_state *state = (uuid_v1_read_binary_state *) arg;
+
+	errcontext("record %lld of file \"%s\"", (long long) state->current, state->filename);
+}
+
+/*
+ * uuid_v1_read_binary
+ *	Read UUID's from a file of 16 byte binary values.
+ *
+ * Arguments are the path of the file, relative to the data directory unless
+ * absolute, the number of records to skip, the number of records to read
+ * (NULL for all remaining ones) and whether to skip invalid values instead of
+ * raising an error.
+ */
+Datum
+uuid_v1_read_binary(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	uuid_v1_read_binary_state *state;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+
+		if (!superuser())
+			ereport(ERROR,
+					(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+					errmsg("must be superuser to read files with uuid_v1_read_binary")));
+
+		if (PG_ARGISNULL(0) || PG_ARGISNULL(1) || PG_ARGISNULL(3))
+			ereport(ERROR,
+					(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+					errmsg("path, offset and skip_invalid must not be null")));
+
+		if (PG_GETARG_INT64(1) < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					errmsg("offset must not be negative")));
+
+		if (!PG_ARGISNULL(2) && PG_GETARG_INT64(2) < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					errmsg("count must not be negative")));
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		state = palloc0(sizeof(uuid_v1_read_binary_state));
+		state->filename = text_to_cstring(PG_GETARG_TEXT_PP(0));
+		state->offset = PG_GETARG_INT64(1);
+		state->count = PG_ARGISNULL(2) ? -1 : PG_GETARG_INT64(2);
+		state->skip_invalid = PG_GETARG_BOOL(3);
+
+		read_binary_open(state, funcctx->multi_call_memory_ctx);
+
+		funcctx->user_fctx = state;
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	state = funcctx->user_fctx;
+
+	/* chunks might be empty if all of their values are skipped */
+	while (state->pos >= state->nchunk)
+	{
+		if (state->next >= state->count)
+		{
+			/* don't keep the file and the chunk until the end of a rescan */
+			if (state->file != NULL)
+				read_binary_close(state->file);
+
+			pfree(state->filename);
+			pfree(state);
+
+			SRF_RETURN_DONE(funcctx);
+		}
+
+		read_binary_chunk(state);
+	}
+
+	SRF_RETURN_NEXT(funcctx, UUIDV1PGetDatum(&state->chunk[state->pos++]));
+}
@@ -0,0 +1,339 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * uuid_v1_set.c
+ *	  Sorted set of version 1 UUID's for large IN-lists.
+ *
+ * A uuid_v1_set is stored exactly like a one-dimensional uuid_v1[] without
+ * NULL's, whose elements are sorted by uuid_v1_cmp0() and unique. This makes
+ * it binary coercible into uuid_v1[], lets membership tests use a binary
+ * search instead of a linear scan and allows to turn them into index
+ * conditions with pre-sorted keys.
+ */
+#include "postgres.h"
+
+#include "access/stratnum.h"
+#include "catalog/pg_am.h"
+#include "datatype/timestamp.h"
+#include "fmgr.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "nodes/pathnodes.h"
+#include "nodes/supportnodes.h"
+#include "optimizer/optimizer.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+#include "utils/fmgroids.h"
+#include "utils/lsyscache.h"
+#include "utils/uuid.h"
+#include "uuid_v1.h"
+
+static int uuid_v1_set_qsort_cmp(const void *a, const void *b);
+static ArrayType* uuid_v1_sort_unique_internal(ArrayType *input);
+static bool uuid_v1_set_member(ArrayType *set, const pg_uuid_v1 *uuid);
+
+PG_FUNCTION_INFO_V1(uuid_v1_set_in);
+PG_FUNCTION_INFO_V1(uuid_v1_set_out);
+PG_FUNCTION_INFO_V1(uuid_v1_set_recv);
+PG_FUNCTION_INFO_V1(uuid_v1_set_send);
+PG_FUNCTION_INFO_V1(uuid_v1_set_to_array);
+PG_FUNCTION_INFO_V1(uuid_v1_sort_unique);
+PG_FUNCTION_INFO_V1(uuid_v1_in_set);
+PG_FUNCTION_INFO_V1(uuid_v1_set_contains);
+PG_FUNCTION_INFO_V1(uuid_v1_set_support);
+
+static int
+uuid_v1_set_qsort_cmp(const void *a, const void *b)
+{
+	return uuid_v1_cmp0((const pg_uuid_v1 *) a, (const pg_uuid_v1 *) b);
+}
+
+/*
+ * uuid_v1_sort_unique_internal
+ *	Build a set from a one-dimensional array of UUID's, dropping NULL's and
+ *	duplicates.
+ */
+static ArrayType*
+uuid_v1_sort_unique_internal(ArrayType *input)
+{
+	int nitems = ArrayGetNItems(ARR_NDIM(input), ARR_DIMS(input));
+	Oid elemtype = ARR_ELEMTYPE(input);
+	pg_uuid_v1 *items;
+	ArrayType *result;
+	char *src;
+	bits8 *bitmap;
+	int bitmask = 1;
+	int nout = 0;
+	int i;
+
+	if (ARR_NDIM(input) > 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_ARRAY_SUBSCRIPT_ERROR),
+				errmsg("array must be one-dimensional")));
+
+	if (nitems == 0)
+		return construct_empty_array(elemtype);
+
+	items = (pg_uuid_v1 *) palloc((Size) nitems * UUID_LEN);
+	src = ARR_DATA_PTR(input);
+	bitmap = ARR_NULLBITMAP(input);
+
+	for (i = 0; i < nitems; i++)
+	{
+		if (bitmap == NULL || (*bitmap & bitmask) != 0)
+		{
+			memcpy(&items[nout++], src, UUID_LEN);
+			src += UUID_LEN;
+		}
+
+		if (bitmap)
+		{
+			bitmask <<= 1;
+			if (bitmask == 0x100)
+			{
+				bitmap++;
+				bitmask = 1;
+			}
+		}
+	}
+
+	if (nout == 0)
+		return construct_empty_array(elemtype);
+
+	qsort(items, nout, UUID_LEN, uuid_v1_set_qsort_cmp);
+
+	/* remove duplicates in place */
+	for (i = 1, nitems = 1; i < nout; i++)
+	{
+		if (uuid_v1_cmp0(&items[nitems - 1], &items[i]) != 0)
+			items[nitems++] = items[i];
+	}
+
+	result = (ArrayType *) palloc0(ARR_OVERHEAD_NONULLS(1) + (Size) nitems * UUID_LEN);
+	SET_VARSIZE(result, ARR_OVERHEAD_NONULLS(1) + (Size) nitems * UUID_LEN);
+	result->ndim = 1;
+	result->dataoffset = 0;
+	result->elemtype = elemtype;
+	ARR_DIMS(result)[0] = nitems;
+	ARR_LBOUND(result)[0] = 1;
+	memcpy(ARR_DATA_PTR(result), items, (Size) nitems * UUID_LEN);
+
+	pfree(items);
+
+	return result;
+}
+
+/*
+ * uuid_v1_set_arg
+ *	Detoasted set argument. If the argument is constant during the scan, it
+ *	is detoasted only once and kept in fn_extra.
+ */
+static ArrayType*
+uuid_v1_set_arg(FunctionCallInfo fcinfo, int argno)
+{
+	ArrayType *set;
+
+	if (fcinfo->flinfo->fn_extra != NULL)
+		return (ArrayType *) fcinfo->flinfo->fn_extra;
+
+	set = DatumGetArrayTypeP(PG_GETARG_DATUM(argno));
+
+	if (get_fn_expr_arg_stable(fcinfo->flinfo, argno))
+	{
+		ArrayType *copy = MemoryContextAlloc(fcinfo->flinfo->fn_mcxt, VARSIZE(set));
+
+		memcpy(copy, set, VARSIZE(set));
+		fcinfo->flinfo->fn_extra = copy;
+		set = copy;
+	}
+
+	return set;
+}
+
+/*
+ * uuid_v1_set_member
+ *	Binary search for the given UUID.
+ *
+ * The loop only narrows down the range without an early exit, so the number
+ * of iterations is always log2(n) and the compiler can use conditional moves.
+ */
+static bool
+uuid_v1_set_member(ArrayType *set, const pg_uuid_v1 *uuid)
+{
+	const pg_uuid_v1 *base = (const pg_uuid_v1 *) ARR_DATA_PTR(set);
+	int n;
+
+	if (ARR_NDIM(set) == 0)
+		return false;
+
+	n = ARR_DIMS(set)[0];
+
+	while (n > 1)
+	{
+		int half = n / 2;
+
+		base = (uuid_v1_cmp0(base + half, uuid) <= 0) ? base + half : base;
+		n -= half;
+	}
+
+	return uuid_v1_cmp0(base, uuid) == 0;
+}
+
+Datum
+uuid_v1_set_in(PG_FUNCTION_ARGS)
+{
+	char *str = PG_GETARG_CSTRING(0);
+	Datum array;
+
+	array = OidInputFunctionCall(F_ARRAY_IN, str,
+								 uuid_v1_type_oid(fcinfo->flinfo->fn_oid), -1);
+
+	PG_RETURN_ARRAYTYPE_P(uuid_v1_sort_unique_internal(DatumGetArrayTypeP(array)));
+}
+
+Datum
+uuid_v1_set_out(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_CSTRING(OidOutputFunctionCall(F_ARRAY_OUT, PG_GETARG_DATUM(0)));
+}
+
+Datum
+uuid_v1_set_recv(PG_FUNCTION_ARGS)
+{
+	StringInfo buf = (StringInfo) PG_GETARG_POINTER(0);
+	Datum array;
+
+	array = OidReceiveFunctionCall(F_ARRAY_RECV, buf,
+								   uuid_v1_type_oid(fcinfo->flinfo->fn_oid), -1);
+
+	PG_RETURN_ARRAYTYPE_P(uuid_v1_sort_unique_internal(DatumGetArrayTypeP(array)));
+}
+
+Datum
+uuid_v1_set_send(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_BYTEA_P(OidSendFunctionCall(F_ARRAY_SEND, PG_GETARG_DATUM(0)));
+}
+
+/*
+ * uuid_v1_set_to_array
+ *	Cast of a set to uuid_v1[], which only changes the type as the storage is
+ *	the same (a binary-compatible cast to an array type is not allowed).
+ */
+Datum
+uuid_v1_set_to_array(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_DATUM(PG_GETARG_DATUM(0));
+}
+
+Datum
+uuid_v1_sort_unique(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_ARRAYTYPE_P(uuid_v1_sort_unique_internal(PG_GETARG_ARRAYTYPE_P(0)));
+}
+
+/*
+ * uuid_v1_in_set
+ *	Implementation of uuid_v1 <@ uuid_v1_set
+ */
+Datum
+uuid_v1_in_set(PG_FUNCTION_ARGS)
+{
+	pg_uuid_v1 *uuid = PG_GETARG_UUIDV1_P(0);
+	ArrayType *set = uuid_v1_set_arg(fcinfo, 1);
+
+	PG_RETURN_BOOL(uuid_v1_set_member(set, uuid));
+}
+
+/*
+ * uuid_v1_set_contains
+ *	Implementation of uuid_v1_set @> uuid_v1
+ */
+Datum
+uuid_v1_set_contains(PG_FUNCTION_ARGS)
+{
+	ArrayType *set = uuid_v1_set_arg(fcinfo, 0);
+	pg_uuid_v1 *uuid = PG_GETARG_UUIDV1_P(1);
+
+	PG_RETURN_BOOL(uuid_v1_set_member(set, uuid));
+}
+
+/*
+ * uuid_v1_set_support
+ *	Planner support function for the set membership operators.
+ *
+ * Membership in a set is turned into a btree index condition of the form
+ * "id = ANY (set::uuid_v1[])". As the set already is sorted and unique, the
+ * preprocessing of the array keys by the index scan is cheap.
+ */
+Datum
+uuid_v1_set_support(PG_FUNCTION_ARGS)
+{
+	Node *rawreq = (Node *) PG_GETARG_POINTER(0);
+	Node *ret = NULL;
+
+	if (IsA(rawreq, SupportRequestIndexCondition))
+	{
+		SupportRequestIndexCondition *req = (SupportRequestIndexCondition *) rawreq;
+		List *args;
+		Node *uuid_arg;
+		Node *set_arg;
+		Oid uuid_type;
+		Oid array_type;
+		Oid eq_opr;
+
+		if (req->index->relam != BTREE_AM_OID)
+			PG_RETURN_POINTER(NULL);
+
+		if (is_opclause(req->node))
+			args = ((OpExpr *) req->node)->args;
+		else if (is_funcclause(req->node))
+			args = ((FuncExpr *) req->node)->args;
+		else
+			PG_RETURN_POINTER(NULL);
+
+		if (list_length(args) != 2 || req->indexarg < 0 || req->indexarg > 1)
+			PG_RETURN_POINTER(NULL);
+
+		uuid_arg = (Node *) list_nth(args, req->indexarg);
+		set_arg = (Node *) list_nth(args, 1 - req->indexarg);
+
+		/* the set must be known when the index scan starts */
+		if (contain_var_clause(set_arg) || contain_volatile_functions(set_arg))
+			PG_RETURN_POINTER(NULL);
+
+		uuid_type = exprType(uuid_arg);
+		array_type = get_array_type(uuid_type);
+		eq_opr = get_opfamily_member(req->opfamily, uuid_type, uuid_type,
+									 BTEqualStrategyNumber);
+
+		if (OidIsValid(array_type) && OidIsValid(eq_opr))
+		{
+			ScalarArrayOpExpr *saop = makeNode(ScalarArrayOpExpr);
+
+			saop->opno = eq_opr;
+			saop->opfuncid = get_opcode(eq_opr);
+			saop->useOr = true;
+			saop->inputcollid = InvalidOid;
+			saop->args = list_make2(uuid_arg,
+									makeRelabelType((Expr *) set_arg, array_type, -1,
+													InvalidOid, COERCE_IMPLICIT_CAST));
+			saop->location = -1;
+
+			req->lossy = false;
+			ret = (Node *) list_make1(saop);
+		}
+	}
+
+	PG_RETURN_POINTER(ret);
+}
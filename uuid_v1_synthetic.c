@@ -0,0 +1,334 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * uuid_v1_synthetic.c
+ *	  Generator for synthetic, but realistic, version 1 UUID workloads.
+ *
+ * The generator models a number of producer nodes, each with its own clock
+ * sequence, emitting UUID's with exponentially distributed inter-arrival
+ * times (which makes them arrive in bursts and collide on the same tick at
+ * high rates) and a configurable fraction of late arrivals. Values are built
+ * directly in their internal representation and the output only depends on
+ * the arguments, so data sets can be reproduced using the same seed.
+ */
+#include <math.h>
+
+#include "postgres.h"
+
+#include "fmgr.h"
+#include "funcapi.h"
+#include "nodes/nodeFuncs.h"
+#include "nodes/supportnodes.h"
+#include "optimizer/optimizer.h"
+#include "utils/hsearch.h"
+#include "utils/timestamp.h"
+#include "utils/uuid.h"
+#include "uuid_v1.h"
+
+/* late arrivals are delayed by up to this many mean inter-arrival times */
+#define SYNTHETIC_MAX_DELAY		1000
+
+/* clock sequence bit set for late arrivals to keep them unique */
+#define SYNTHETIC_LATE_CLOCKSEQ	0x2000
+
+/* maximum UUID timestamp (60 bits) */
+#define SYNTHETIC_MAX_TICKS		INT64CONST(0x0FFFFFFFFFFFFFFF)
+
+/* timestamp of a late arrival already produced by a node */
+typedef struct synthetic_late_key
+{
+	int64 timestamp;
+	int64 node;
+} synthetic_late_key;
+
+typedef struct synthetic_late_entry
+{
+	synthetic_late_key key;
+	int32 count;			/* late arrivals of the node at the timestamp */
+} synthetic_late_entry;
+
+typedef struct uuid_v1_synthetic_state
+{
+	uint64 prng;			/* state of the pseudo-random number generator */
+	int64 base;				/* UUID timestamp of the start */
+	double clock;			/* ticks passed since start */
+	double interval;		/* mean inter-arrival time in ticks */
+	double disorder;		/* fraction of late arrivals */
+	int nodes;
+	int64 *last_tick;		/* last on-time timestamp per node */
+	int16 *clock_seq;		/* clock sequence per node */
+	unsigned char *node;	/* node values, UUID_NODE_LEN bytes each */
+	HTAB *late;				/* timestamps of late arrivals per node */
+	long late_limit;		/* number of entries triggering a cleanup */
+} uuid_v1_synthetic_state;
+
+static uint64 synthetic_next(uint64 *state);
+static double synthetic_uniform(uint64 *state);
+static void synthetic_prune_late(uuid_v1_synthetic_state *state, int64 oldest);
+
+PG_FUNCTION_INFO_V1(uuid_v1_synthetic);
+PG_FUNCTION_INFO_V1(uuid_v1_synthetic_support);
+
+/*
+ * synthetic_next
+ *	SplitMix64 pseudo-random number generator.
+ *
+ * It is small, fast and only depends on integer arithmetic, so sequences
+ * are identical on all platforms.
+ */
+static uint64
+synthetic_next(uint64 *state)
+{
+	uint64 z = (*state += UINT64CONST(0x9E3779B97F4A7C15));
+
+	z = (z ^ (z >> 30)) * UINT64CONST(0xBF58476D1CE4E5B9);
+	z = (z ^ (z >> 27)) * UINT64CONST(0x94D049BB133111EB);
+	return z ^ (z >> 31);
+}
+
+/*
+ * synthetic_uniform
+ *	Uniformly distributed double in the range (0, 1].
+ */
+static double
+synthetic_uniform(uint64 *state)
+{
+	return ((double) (synthetic_next(state) >> 11) + 1.0) / 9007199254740992.0;
+}
+
+/*
+ * synthetic_prune_late
+ *	Forget the late arrivals older than any late arrival still to come.
+ */
+static void
+synthetic_prune_late(uuid_v1_synthetic_state *state, int64 oldest)
+{
+	HASH_SEQ_STATUS status;
+	synthetic_late_entry *entry;
+
+	hash_seq_init(&status, state->late);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (entry->key.timestamp < oldest)
+			(void) hash_search(state->late, &entry->key, HASH_REMOVE, NULL);
+	}
+
+	state->late_limit = Max(1024, 2 * hash_get_num_entries(state->late));
+}
+
+/*
+ * uuid_v1_synthetic
+ *	Generate a set of synthetic version 1 UUID's.
+ *
+ * Arguments are the number of values, the timestamp of the first value, the
+ * mean rate in values per second, the number of producer nodes, the number
+ * of distinct clock sequence values, the fraction of late arrivals and the
+ * seed of the pseudo-random number generator.
+ */
+Datum
+uuid_v1_synthetic(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	uuid_v1_synthetic_state *state;
+	pg_uuid_v1 *uuid;
+	int64 timestamp;
+	int node;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		int64 count = PG_GETARG_INT64(0);
+		TimestampTz start = PG_GETARG_TIMESTAMPTZ(1);
+		float8 rate = PG_GETARG_FLOAT8(2);
+		int32 nodes = PG_GETARG_INT32(3);
+		int32 clockseq_spread = PG_GETARG_INT32(4);
+		float8 disorder = PG_GETARG_FLOAT8(5);
+		int64 seed = PG_GETARG_INT64(6);
+		MemoryContext oldcontext;
+		HASHCTL info;
+		int i;
+
+		if (count < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					errmsg("count must not be negative")));
+
+		if (!(rate > 0.0) || isinf(rate))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					errmsg("rate must be greater than zero")));
+
+		if (nodes < 1)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					errmsg("nodes must be greater than zero")));
+
+		if (clockseq_spread < 1 || clockseq_spread > SYNTHETIC_LATE_CLOCKSEQ)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					errmsg("clockseq_spread must be between 1 and %d", SYNTHETIC_LATE_CLOCKSEQ)));
+
+		if (!(disorder >= 0.0 && disorder <= 1.0))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					errmsg("disorder must be between 0 and 1")));
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		state = palloc(sizeof(uuid_v1_synthetic_state));
+		state->prng = (uint64) seed;
+		state->base = to_uuid_timestamp(start);
+		state->clock = 0.0;
+		state->interval = 10000000.0 / rate;
+		state->disorder = disorder;
+		state->nodes = nodes;
+		state->last_tick = palloc(sizeof(int64) * nodes);
+		state->clock_seq = palloc(sizeof(int16) * nodes);
+		state->node = palloc(UUID_NODE_LEN * nodes);
+
+		memset(&info, 0, sizeof(info));
+		info.keysize = sizeof(synthetic_late_key);
+		info.entrysize = sizeof(synthetic_late_entry);
+		info.hcxt = funcctx->multi_call_memory_ctx;
+		state->late = hash_create("uuid_v1 synthetic late arrivals", 1024, &info,
+								  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+		state->late_limit = 1024;
+
+		if (state->base < 0 || state->base > SYNTHETIC_MAX_TICKS)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+					errmsg("timestamp out of range")));
+
+		for (i = 0; i < nodes; i++)
+		{
+			uint64 value = synthetic_next(&state->prng);
+			unsigned char *dst = state->node + i * UUID_NODE_LEN;
+			int j;
+
+			for (j = 0; j < UUID_NODE_LEN; j++)
+				dst[j] = (value >> (8 * j)) & 0xFF;
+
+			/* random node values must have the multicast bit set */
+			dst[0] |= 0x01;
+
+			state->last_tick[i] = -1;
+			state->clock_seq[i] = synthetic_next(&state->prng) % clockseq_spread;
+		}
+
+		funcctx->max_calls = count;
+		funcctx->user_fctx = state;
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	state = funcctx->user_fctx;
+
+	if (funcctx->call_cntr >= funcctx->max_calls)
+		SRF_RETURN_DONE(funcctx);
+
+	/* exponentially distributed inter-arrival times */
+	state->clock += -log(synthetic_uniform(&state->prng)) * state->interval;
+	timestamp = state->base + (int64) state->clock;
+	node = synthetic_next(&state->prng) % state->nodes;
+
+	uuid = (pg_uuid_v1 *) palloc(UUID_LEN);
+	memcpy(uuid->node, state->node + node * UUID_NODE_LEN, UUID_NODE_LEN);
+
+	if (state->disorder > 0.0 && synthetic_uniform(&state->prng) <= state->disorder)
+	{
+		int64 max_delay = (int64) (state->interval * SYNTHETIC_MAX_DELAY) + 1;
+		synthetic_late_key key;
+		synthetic_late_entry *entry;
+		bool found;
+
+		timestamp -= 1 + synthetic_next(&state->prng) % max_delay;
+		if (timestamp < 0)
+			timestamp = 0;
+
+		/*
+		 * Like a node whose clock went backwards, each late arrival at a tick
+		 * already used by an earlier one of the node gets the next clock
+		 * sequence. Only when all of them are used at that tick, it moves on
+		 * to the next tick.
+		 */
+		key.node = node;
+		key.timestamp = timestamp;
+		for (;;)
+		{
+			entry = hash_search(state->late, &key, HASH_ENTER, &found);
+			if (!found)
+				entry->count = 0;
+			if (entry->count < SYNTHETIC_LATE_CLOCKSEQ)
+				break;
+			key.timestamp++;
+		}
+
+		timestamp = key.timestamp;
+		uuid->clock_seq = SYNTHETIC_LATE_CLOCKSEQ |
+			((state->clock_seq[node] + entry->count++) & (SYNTHETIC_LATE_CLOCKSEQ - 1));
+
+		if (hash_get_num_entries(state->late) > state->late_limit)
+			synthetic_prune_late(state, state->base + (int64) state->clock - max_delay);
+	}
+	else
+	{
+		/* a node never produces the same timestamp twice */
+		if (timestamp <= state->last_tick[node])
+			timestamp = state->last_tick[node] + 1;
+
+		state->last_tick[node] = timestamp;
+		uuid->clock_seq = state->clock_seq[node];
+	}
+
+	if (timestamp > SYNTHETIC_MAX_TICKS)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+				errmsg("timestamp out of range")));
+
+	uuid->timestamp = timestamp;
+
+	SRF_RETURN_NEXT(funcctx, UUIDV1PGetDatum(uuid));
+}
+
+/*
+ * uuid_v1_synthetic_support
+ *	Planner support function providing the row estimate.
+ */
+Datum
+uuid_v1_synthetic_support(PG_FUNCTION_ARGS)
+{
+	Node *rawreq = (Node *) PG_GETARG_POINTER(0);
+	Node *ret = NULL;
+
+	if (IsA(rawreq, SupportRequestRows))
+	{
+		SupportRequestRows *req = (SupportRequestRows *) rawreq;
+
+		if (is_funcclause(req->node))
+		{
+			List *args = ((FuncExpr *) req->node)->args;
+			Node *count = estimate_expression_value(req->root, linitial(args));
+
+			if (IsA(count, Const) && !((Const *) count)->constisnull)
+			{
+				int64 rows = DatumGetInt64(((Const *) count)->constvalue);
+
+				req->rows = rows > 0 ? (double) rows : 0.0;
+				ret = (Node *) req;
+			}
+		}
+	}
+
+	PG_RETURN_POINTER(ret);
+}
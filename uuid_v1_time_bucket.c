@@ -0,0 +1,387 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * uuid_v1_time_bucket.c
+ *	  Time buckets of version 1 UUID's with ordered grouping support.
+ *
+ * Buckets are computed on the raw UUID timestamp (100 ns ticks), so the
+ * bucket is a non-decreasing function of the UUID in its default sort order.
+ * The planner does not know about that, so grouping by a bucket would always
+ * sort or hash the input. A create_upper_paths_hook therefore adds a sorted
+ * aggregation on top of an ordered scan of a uuid_v1_ops index, which streams
+ * the groups in bucket order without any sort.
+ */
+#include "postgres.h"
+
+#include "access/stratnum.h"
+#include "access/sysattr.h"
+#include "catalog/pg_am.h"
+#include "commands/defrem.h"
+#include "common/int.h"
+#include "datatype/timestamp.h"
+#include "fmgr.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "nodes/supportnodes.h"
+#include "optimizer/cost.h"
+#include "optimizer/optimizer.h"
+#include "optimizer/pathnode.h"
+#include "optimizer/paths.h"
+#include "optimizer/planner.h"
+#if PG_VERSION_NUM >= 140000
+#include "optimizer/prep.h"
+#endif
+#include "optimizer/tlist.h"
+#include "utils/lsyscache.h"
+#include "utils/selfuncs.h"
+#include "utils/timestamp.h"
+#include "utils/uuid.h"
+#include "uuid_v1.h"
+
+/* default origin of buckets, Monday 2000-01-03 00:00:00 UTC */
+#define TIME_BUCKET_DEFAULT_ORIGIN	(INT64CONST(2) * USECS_PER_DAY)
+
+static create_upper_paths_hook_type prev_create_upper_paths_hook = NULL;
+
+static int64 time_bucket_ticks(FunctionCallInfo fcinfo);
+static void time_bucket_upper_paths(PlannerInfo *root, UpperRelationKind stage,
+									RelOptInfo *input_rel, RelOptInfo *output_rel,
+									void *extra);
+static Var *time_bucket_argument(Expr *expr, Index relid);
+static bool time_bucket_index_only(RelOptInfo *rel, IndexOptInfo *index);
+
+PG_FUNCTION_INFO_V1(uuid_v1_time_bucket);
+PG_FUNCTION_INFO_V1(uuid_v1_time_bucket_lower);
+PG_FUNCTION_INFO_V1(uuid_v1_time_bucket_support);
+
+/*
+ * uuid_v1_time_bucket_init
+ *	Install the planner hook, called from _PG_init().
+ */
+void
+uuid_v1_time_bucket_init(void)
+{
+	prev_create_upper_paths_hook = create_upper_paths_hook;
+	create_upper_paths_hook = time_bucket_upper_paths;
+}
+
+/*
+ * time_bucket_ticks
+ *	Compute the UUID timestamp of the start of the bucket.
+ *
+ * Arguments are the bucket width, the UUID and, optionally, the origin of
+ * the buckets.
+ */
+static int64
+time_bucket_ticks(FunctionCallInfo fcinfo)
+{
+	Interval *width = PG_GETARG_INTERVAL_P(0);
+	pg_uuid_v1 *uuid = PG_GETARG_UUIDV1_P(1);
+	TimestampTz origin = PG_NARGS() > 2 ? PG_GETARG_TIMESTAMPTZ(2) : TIME_BUCKET_DEFAULT_ORIGIN;
+	int64 width_ticks;
+	int64 origin_ticks;
+	int64 delta;
+	int64 buckets;
+
+	if (width->month != 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				errmsg("bucket width must not contain months or years")));
+
+	if (pg_mul_s64_overflow(width->day, USECS_PER_DAY, &width_ticks) ||
+		pg_add_s64_overflow(width_ticks, width->time, &width_ticks) ||
+		pg_mul_s64_overflow(width_ticks, 10, &width_ticks))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+				errmsg("interval out of range")));
+
+	if (width_ticks <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				errmsg("bucket width must be greater than zero")));
+
+	if (!uuid_timestamp_in_range(origin))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+				errmsg("origin out of range")));
+
+	origin_ticks = to_uuid_timestamp(origin);
+
+	/* both values are at most 60 bits once the origin is checked */
+	delta = uuid->timestamp - origin_ticks;
+	buckets = delta / width_ticks;
+	if (delta % width_ticks < 0)
+		buckets--;
+
+	return origin_ticks + buckets * width_ticks;
+}
+
+/*
+ * uuid_v1_time_bucket
+ *	Start of the time bucket of a UUID.
+ */
+Datum
+uuid_v1_time_bucket(PG_FUNCTION_ARGS)
+{
+	int64 ticks = time_bucket_ticks(fcinfo);
+	pg_uuid_v1 bucket;
+	TimestampTz timestamp;
+
+	bucket.timestamp = ticks;
+	timestamp = uuid_v1_timestamptz(&bucket);
+
+	if (!IS_VALID_TIMESTAMP(timestamp))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+				errmsg("timestamp out of range")));
+
+	PG_RETURN_TIMESTAMPTZ(timestamp);
+}
+
+/*
+ * uuid_v1_time_bucket_lower
+ *	Smallest UUID of the time bucket of a UUID, e.g. for keyset pagination.
+ */
+Datum
+uuid_v1_time_bucket_lower(PG_FUNCTION_ARGS)
+{
+	int64 ticks = time_bucket_ticks(fcinfo);
+	pg_uuid_v1 *bucket;
+
+	if (ticks < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+				errmsg("timestamp out of range")));
+
+	bucket = (pg_uuid_v1 *) palloc0(UUID_LEN);
+	bucket->timestamp = ticks;
+
+	PG_RETURN_UUIDV1_P(bucket);
+}
+
+/*
+ * uuid_v1_time_bucket_support
+ *	Planner support function of the bucket functions.
+ *
+ * It does not answer any request, but makes sure the library (and with it
+ * the planner hook) is loaded as soon as a query using a bucket function
+ * gets planned.
+ */
+Datum
+uuid_v1_time_bucket_support(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_POINTER(NULL);
+}
+
+/*
+ * time_bucket_argument
+ *	If the expression is a call of a bucket function on a column of the given
+ *	relation with arguments otherwise being constant during the scan, return
+ *	that column.
+ */
+static Var*
+time_bucket_argument(Expr *expr, Index relid)
+{
+	FuncExpr *func;
+	FmgrInfo flinfo;
+	Expr *arg;
+	ListCell *lc;
+	int i = 0;
+
+	if (!IsA(expr, FuncExpr))
+		return NULL;
+
+	func = (FuncExpr *) expr;
+
+	fmgr_info(func->funcid, &flinfo);
+	if (flinfo.fn_addr != uuid_v1_time_bucket && flinfo.fn_addr != uuid_v1_time_bucket_lower)
+		return NULL;
+
+	/* all but the UUID (second) argument must be constant during the scan */
+	foreach(lc, func->args)
+	{
+		if (i++ != 1 && (contain_var_clause(lfirst(lc)) ||
+						 contain_volatile_functions(lfirst(lc))))
+			return NULL;
+	}
+
+	arg = (Expr *) lsecond(func->args);
+	while (IsA(arg, RelabelType))
+		arg = ((RelabelType *) arg)->arg;
+
+	if (!IsA(arg, Var) || ((Var *) arg)->varno != relid ||
+		((Var *) arg)->varlevelsup != 0)
+		return NULL;
+
+	return (Var *) arg;
+}
+
+/*
+ * time_bucket_index_only
+ *	Check whether the index covers all columns the relation needs, like
+ *	check_index_only() of the planner does.
+ */
+static bool
+time_bucket_index_only(RelOptInfo *rel, IndexOptInfo *index)
+{
+	Bitmapset *attrs_used = NULL;
+	Bitmapset *index_attrs = NULL;
+	ListCell *lc;
+	int i;
+
+	if (!enable_indexonlyscan)
+		return false;
+
+	pull_varattnos((Node *) rel->reltarget->exprs, rel->relid, &attrs_used);
+
+	foreach(lc, index->indrestrictinfo)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+		pull_varattnos((Node *) rinfo->clause, rel->relid, &attrs_used);
+	}
+
+	for (i = 0; i < index->ncolumns; i++)
+	{
+		if (index->indexkeys[i] != 0 && index->canreturn[i])
+			index_attrs = bms_add_member(index_attrs,
+										 index->indexkeys[i] - FirstLowInvalidHeapAttributeNumber);
+	}
+
+	return bms_is_subset(attrs_used, index_attrs);
+}
+
+/*
+ * time_bucket_upper_paths
+ *	Add a sorted aggregation on an index scan when grouping by a bucket.
+ *
+ * This only handles the plain case of a single table grouped by a single
+ * bucket expression on the leading column of a btree index using the
+ * default (time ordered) operator class.
+ */
+static void
+time_bucket_upper_paths(PlannerInfo *root, UpperRelationKind stage,
+						RelOptInfo *input_rel, RelOptInfo *output_rel,
+						void *extra)
+{
+	GroupPathExtraData *group_extra = (GroupPathExtraData *) extra;
+	Query *parse = root->parse;
+	List *group_clause;
+	PathKey *pathkey;
+	Expr *group_expr;
+	Var *var;
+	Oid opfamily;
+	bool descending;
+	AggClauseCosts agg_costs;
+	ListCell *lc;
+
+	if (prev_create_upper_paths_hook)
+		prev_create_upper_paths_hook(root, stage, input_rel, output_rel, extra);
+
+	if (stage != UPPERREL_GROUP_AGG)
+		return;
+
+#if PG_VERSION_NUM >= 160000
+	group_clause = root->processed_groupClause;
+#else
+	group_clause = parse->groupClause;
+#endif
+
+	if (parse->groupingSets != NIL || list_length(group_clause) != 1 ||
+		list_length(root->group_pathkeys) != 1 ||
+		group_extra->patype != PARTITIONWISE_AGGREGATE_NONE ||
+		input_rel->reloptkind != RELOPT_BASEREL ||
+		input_rel->rtekind != RTE_RELATION)
+		return;
+
+	group_expr = (Expr *) get_sortgroupclause_expr(linitial(group_clause), parse->targetList);
+	var = time_bucket_argument(group_expr, input_rel->relid);
+	if (var == NULL)
+		return;
+
+	opfamily = get_opclass_family(GetDefaultOpClass(var->vartype, BTREE_AM_OID));
+	pathkey = linitial_node(PathKey, root->group_pathkeys);
+
+	/* agg_final_costs of the extra data only covers partial aggregation */
+	memset(&agg_costs, 0, sizeof(agg_costs));
+#if PG_VERSION_NUM >= 140000
+	get_agg_clause_costs(root, AGGSPLIT_SIMPLE, &agg_costs);
+#else
+	get_agg_clause_costs(root, (Node *) root->processed_tlist, AGGSPLIT_SIMPLE, &agg_costs);
+	get_agg_clause_costs(root, parse->havingQual, AGGSPLIT_SIMPLE, &agg_costs);
+#endif
+
+#if PG_VERSION_NUM >= 180000
+	descending = (pathkey->pk_cmptype == COMPARE_GT);
+#else
+	descending = (pathkey->pk_strategy == BTGreaterStrategyNumber);
+#endif
+
+	foreach(lc, input_rel->indexlist)
+	{
+		IndexOptInfo *index = lfirst_node(IndexOptInfo, lc);
+		IndexPath *index_path;
+		AggPath *agg_path;
+		List *index_clauses = NIL;
+		bool backward;
+		double groups;
+		ListCell *lc2;
+
+		if (index->relam != BTREE_AM_OID || index->indexkeys[0] != var->varattno ||
+			index->opfamily[0] != opfamily ||
+			(index->indpred != NIL && !index->predOK))
+			continue;
+
+		/* scan direction and NULL placement must match the grouping order */
+		backward = (descending != index->reverse_sort[0]);
+		if (pathkey->pk_nulls_first != (backward != index->nulls_first[0]))
+			continue;
+
+		/* reuse the index conditions of the paths the planner considered */
+		foreach(lc2, input_rel->pathlist)
+		{
+			Path *path = (Path *) lfirst(lc2);
+
+			if (IsA(path, ProjectionPath))
+				path = ((ProjectionPath *) path)->subpath;
+
+			if (IsA(path, IndexPath) && ((IndexPath *) path)->indexinfo == index &&
+				PATH_REQ_OUTER(path) == NULL)
+			{
+				index_clauses = ((IndexPath *) path)->indexclauses;
+				break;
+			}
+		}
+
+		index_path = create_index_path(root, index, index_clauses, NIL, NIL, NIL,
+									   backward ? BackwardScanDirection : ForwardScanDirection,
+									   time_bucket_index_only(input_rel, index),
+									   NULL, 1.0, false);
+
+		groups = estimate_num_groups(root, list_make1(group_expr), index_path->path.rows,
+#if PG_VERSION_NUM >= 140000
+									 NULL,
+#endif
+									 NULL);
+
+		agg_path = create_agg_path(root, output_rel, (Path *) index_path,
+								   output_rel->reltarget, AGG_SORTED, AGGSPLIT_SIMPLE,
+								   group_clause, (List *) group_extra->havingQual,
+								   &agg_costs, groups);
+
+		/* the groups come out in bucket order */
+		agg_path->path.pathkeys = root->group_pathkeys;
+
+		add_path(output_rel, (Path *) agg_path);
+	}
+}
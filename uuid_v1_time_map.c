@@ -0,0 +1,1205 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * uuid_v1_time_map.c
+ *	  Block-range time map with a custom scan skipping ranges that can't match.
+ *
+ * Tables with time ordered uuid_v1 keys are mostly appended to, so every
+ * range of heap blocks only covers a short span of UUID timestamps. The time
+ * map keeps the minimum and maximum timestamp per range of a column in shared
+ * memory, much like a BRIN index would, but without an index to create or
+ * maintain: the summaries are recorded by uuid_v1_time_map_summarize() and,
+ * as a side effect, whenever the custom scan reads all blocks of a range.
+ * Scans with time predicates on the column then skip the ranges which can't
+ * contain a match.
+ *
+ * Summaries are only kept for ranges whose blocks are all-visible, together
+ * with the LSN's of the visibility map pages covering the range. Any change
+ * to a block clears its all-visible bit, and setting the bit again (by a
+ * vacuum) advances the LSN of the visibility map page, so a summary is only
+ * ever used while the contents of the range are unchanged. This requires the
+ * relation to be WAL-logged, so unlogged and temporary tables are left alone.
+ *
+ * The map is keyed by relfilenode. Once it is full, the least recently used
+ * summaries are evicted, and the summaries of a relation (or database) are
+ * removed when it is dropped. Summaries of a relfilenode replaced by TRUNCATE
+ * or a table rewrite are never used again and age out of the map.
+ */
+#include <math.h>
+
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "access/htup_details.h"
+#include "access/relscan.h"
+#include "access/stratnum.h"
+#include "access/table.h"
+#include "access/tableam.h"
+#include "access/visibilitymap.h"
+#include "catalog/objectaccess.h"
+#include "catalog/objectaddress.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_class.h"
+#include "catalog/pg_database.h"
+#include "commands/explain.h"
+#if PG_VERSION_NUM >= 180000
+#include "commands/explain_format.h"
+#include "commands/explain_state.h"
+#endif
+#include "common/int.h"
+#include "executor/executor.h"
+#include "fmgr.h"
+#include "miscadmin.h"
+#include "nodes/extensible.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
+#include "optimizer/pathnode.h"
+#include "optimizer/paths.h"
+#include "optimizer/restrictinfo.h"
+#include "storage/bufmgr.h"
+#include "storage/bufpage.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/acl.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/syscache.h"
+#include "utils/timestamp.h"
+#include "utils/uuid.h"
+#include "uuid_v1.h"
+
+/* number of heap blocks summarized together */
+#define TIME_MAP_RANGE_BLOCKS	128
+
+/* heap blocks covered by a single visibility map page */
+#define TIME_MAP_VM_BLOCKS \
+	((BlockNumber) ((BLCKSZ - MAXALIGN(SizeOfPageHeaderData)) * (BITS_PER_BYTE / BITS_PER_HEAPBLOCK)))
+
+/* flag added to the btree strategy of operators comparing with a timestamp */
+#define TIME_MAP_TIMESTAMP		0x10
+
+/* maximum number of ranges looked up in the map when costing a scan */
+#define TIME_MAP_COST_SAMPLES	1024
+
+/*
+ * CPU cost of deciding about a range: the lookup in the map and the check of
+ * the visibility map bit of every block
+ */
+#define TIME_MAP_RANGE_COST		(cpu_operator_cost * (TIME_MAP_RANGE_BLOCKS + 1))
+
+#define TIME_MAP_NAME			"uuid_v1_time_map"
+
+typedef struct uuid_v1_time_map_key
+{
+	Oid spcoid;				/* physical relation (relfilenode) */
+	Oid dboid;
+	Oid relnumber;
+	BlockNumber range;		/* first block / TIME_MAP_RANGE_BLOCKS */
+	AttrNumber attnum;
+} uuid_v1_time_map_key;
+
+typedef struct uuid_v1_time_map_entry
+{
+	uuid_v1_time_map_key key;
+	int64 min_ts;			/* UUID timestamps, min > max if no values */
+	int64 max_ts;
+	XLogRecPtr lsn_first;	/* visibility map LSN's at summary time */
+	XLogRecPtr lsn_last;
+	pg_atomic_uint64 last_used;	/* value of the use clock at the last use */
+} uuid_v1_time_map_entry;
+
+typedef struct uuid_v1_time_map_shared
+{
+	pg_atomic_uint64 clock;	/* incremented on every use of an entry */
+} uuid_v1_time_map_shared;
+
+typedef struct uuid_v1_time_map_state
+{
+	CustomScanState css;
+	AttrNumber attnum;
+	List *strategies;
+	List *bounds;			/* ExprState of the comparison values */
+	TableScanDesc scan;
+	Buffer vmbuffer;
+	bool use_map;
+	bool started;
+	bool in_range;
+	bool empty;				/* no row can match the bounds */
+	int64 lo;				/* bounds of the UUID timestamp, inclusive */
+	int64 hi;
+	BlockNumber nblocks;
+	BlockNumber next_range;
+	uuid_v1_time_map_entry current;	/* summary of the range being read */
+	bool summarize;
+	int64 ranges_skipped;
+	int64 ranges_summarized;
+} uuid_v1_time_map_state;
+
+/* GUC: use the custom scan */
+static bool time_map_enabled = true;
+
+/* GUC: maximum number of ranges in the map */
+static int time_map_max_ranges = 65536;
+
+static HTAB *time_map = NULL;
+static LWLock *time_map_lock = NULL;
+static uuid_v1_time_map_shared *time_map_shared = NULL;
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+#if PG_VERSION_NUM >= 150000
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+#endif
+static set_rel_pathlist_hook_type prev_set_rel_pathlist_hook = NULL;
+static object_access_hook_type prev_object_access_hook = NULL;
+
+static void time_map_shmem_request(void);
+static void time_map_shmem_startup(void);
+static void time_map_object_access(ObjectAccessType access, Oid classId,
+								   Oid objectId, int subId, void *arg);
+static void time_map_forget(Oid spcoid, Oid dboid, Oid relnumber);
+static void time_map_evict(void);
+static int time_map_strategy(Oid opno);
+static void time_map_rel_pathlist(PlannerInfo *root, RelOptInfo *rel,
+								  Index rti, RangeTblEntry *rte);
+static Plan *time_map_plan_path(PlannerInfo *root, RelOptInfo *rel,
+								CustomPath *best_path, List *tlist,
+								List *clauses, List *custom_plans);
+static Node *time_map_create_state(CustomScan *cscan);
+static void time_map_begin(CustomScanState *node, EState *estate, int eflags);
+static TupleTableSlot *time_map_exec(CustomScanState *node);
+static void time_map_end(CustomScanState *node);
+static void time_map_rescan(CustomScanState *node);
+static void time_map_explain(CustomScanState *node, List *ancestors,
+							 ExplainState *es);
+static double time_map_prunable(Relation rel, BlockNumber pages,
+								AttrNumber attnum, List *strategies,
+								List *values);
+static void time_map_narrow(int strategy, Datum value, int64 *lo, int64 *hi);
+static void time_map_bounds(uuid_v1_time_map_state *state);
+static void time_map_set_key(Relation rel, AttrNumber attnum,
+							 uuid_v1_time_map_key *key);
+static bool time_map_visible(Relation rel, Buffer *vmbuffer, BlockNumber start,
+							 BlockNumber end, XLogRecPtr *lsn_first,
+							 XLogRecPtr *lsn_last);
+static bool time_map_skip_range(uuid_v1_time_map_state *state,
+								BlockNumber start, BlockNumber end);
+static bool time_map_store_range(Relation rel, Buffer *vmbuffer,
+								 uuid_v1_time_map_entry *summary,
+								 BlockNumber start, BlockNumber end);
+static TupleTableSlot *time_map_next(ScanState *ss);
+static bool time_map_recheck(ScanState *ss, TupleTableSlot *slot);
+
+PG_FUNCTION_INFO_V1(uuid_v1_time_map_summarize);
+
+static const CustomPathMethods time_map_path_methods = {
+	.CustomName = TIME_MAP_NAME,
+	.PlanCustomPath = time_map_plan_path,
+};
+
+static const CustomScanMethods time_map_scan_methods = {
+	.CustomName = TIME_MAP_NAME,
+	.CreateCustomScanState = time_map_create_state,
+};
+
+static const CustomExecMethods time_map_exec_methods = {
+	.CustomName = TIME_MAP_NAME,
+	.BeginCustomScan = time_map_begin,
+	.ExecCustomScan = time_map_exec,
+	.EndCustomScan = time_map_end,
+	.ReScanCustomScan = time_map_rescan,
+	.ExplainCustomScan = time_map_explain,
+};
+
+/* operators usable for skipping ranges, by implementation function */
+static const struct
+{
+	PGFunction fn;
+	int strategy;
+} time_map_operators[] = {
+	{uuid_v1_lt, BTLessStrategyNumber},
+	{uuid_v1_le, BTLessEqualStrategyNumber},
+	{uuid_v1_eq, BTEqualStrategyNumber},
+	{uuid_v1_ge, BTGreaterEqualStrategyNumber},
+	{uuid_v1_gt, BTGreaterStrategyNumber},
+	{uuid_v1_lt_ts, BTLessStrategyNumber | TIME_MAP_TIMESTAMP},
+	{uuid_v1_le_ts, BTLessEqualStrategyNumber | TIME_MAP_TIMESTAMP},
+	{uuid_v1_eq_ts, BTEqualStrategyNumber | TIME_MAP_TIMESTAMP},
+	{uuid_v1_ge_ts, BTGreaterEqualStrategyNumber | TIME_MAP_TIMESTAMP},
+	{uuid_v1_gt_ts, BTGreaterStrategyNumber | TIME_MAP_TIMESTAMP}
+};
+
+/*
+ * uuid_v1_time_map_init
+ *	Module load callback. The planner hook is always installed, but the map
+ *	(and so the custom scan) is only available if we are loaded via
+ *	shared_preload_libraries.
+ */
+void
+uuid_v1_time_map_init(void)
+{
+	DefineCustomBoolVariable("uuid_v1.time_map",
+							 "Enables scans skipping block ranges using the uuid_v1 time map.",
+							 NULL,
+							 &time_map_enabled,
+							 true,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	RegisterCustomScanMethods(&time_map_scan_methods);
+
+	prev_set_rel_pathlist_hook = set_rel_pathlist_hook;
+	set_rel_pathlist_hook = time_map_rel_pathlist;
+
+	if (!process_shared_preload_libraries_in_progress)
+		return;
+
+	DefineCustomIntVariable("uuid_v1.time_map_max_ranges",
+							"Sets the maximum number of block ranges summarized in the uuid_v1 time map.",
+							NULL,
+							&time_map_max_ranges,
+							65536,
+							1024,
+							INT_MAX / 2,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+#if PG_VERSION_NUM >= 150000
+	prev_shmem_request_hook = shmem_request_hook;
+	shmem_request_hook = time_map_shmem_request;
+#else
+	time_map_shmem_request();
+#endif
+
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = time_map_shmem_startup;
+
+	prev_object_access_hook = object_access_hook;
+	object_access_hook = time_map_object_access;
+}
+
+static void
+time_map_shmem_request(void)
+{
+#if PG_VERSION_NUM >= 150000
+	if (prev_shmem_request_hook)
+		prev_shmem_request_hook();
+#endif
+
+	RequestAddinShmemSpace(add_size(sizeof(uuid_v1_time_map_shared),
+									hash_estimate_size(time_map_max_ranges,
+													   sizeof(uuid_v1_time_map_entry))));
+	RequestNamedLWLockTranche(TIME_MAP_NAME, 1);
+}
+
+static void
+time_map_shmem_startup(void)
+{
+	HASHCTL info;
+	bool found;
+
+	if (prev_shmem_startup_hook)
+		prev_shmem_startup_hook();
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(uuid_v1_time_map_key);
+	info.entrysize = sizeof(uuid_v1_time_map_entry);
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	time_map_lock = &(GetNamedLWLockTranche(TIME_MAP_NAME))->lock;
+	time_map_shared = ShmemInitStruct("uuid_v1 time map clock",
+									  sizeof(uuid_v1_time_map_shared), &found);
+	if (!found)
+		pg_atomic_init_u64(&time_map_shared->clock, 0);
+
+	time_map = ShmemInitHash("uuid_v1 time map",
+							 time_map_max_ranges, time_map_max_ranges,
+							 &info, HASH_ELEM | HASH_BLOBS);
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+/*
+ * time_map_object_access
+ *	Remove the summaries of dropped relations and databases, so they are
+ *	neither kept around nor used for a new relation reusing the relfilenode.
+ *
+ * The entries are removed even if the dropping transaction aborts later on,
+ * which just means the ranges have to be summarized again.
+ */
+static void
+time_map_object_access(ObjectAccessType access, Oid classId, Oid objectId,
+					   int subId, void *arg)
+{
+	if (prev_object_access_hook)
+		prev_object_access_hook(access, classId, objectId, subId, arg);
+
+	if (access != OAT_DROP || time_map == NULL)
+		return;
+
+	if (classId == DatabaseRelationId)
+		time_map_forget(InvalidOid, objectId, InvalidOid);
+	else if (classId == RelationRelationId && subId == 0)
+	{
+		HeapTuple tuple = SearchSysCache1(RELOID, ObjectIdGetDatum(objectId));
+		Form_pg_class form;
+
+		if (!HeapTupleIsValid(tuple))
+			return;
+
+		form = (Form_pg_class) GETSTRUCT(tuple);
+
+		/* mapped and shared catalogs are never summarized */
+		if (form->relkind == RELKIND_RELATION && OidIsValid(form->relfilenode) &&
+			!form->relisshared)
+			time_map_forget(OidIsValid(form->reltablespace) ?
+							form->reltablespace : MyDatabaseTableSpace,
+							MyDatabaseId, form->relfilenode);
+
+		ReleaseSysCache(tuple);
+	}
+}
+
+/*
+ * time_map_forget
+ *	Remove all entries of the given relfilenode, or of the whole database if
+ *	no relfilenode is given.
+ */
+static void
+time_map_forget(Oid spcoid, Oid dboid, Oid relnumber)
+{
+	HASH_SEQ_STATUS status;
+	uuid_v1_time_map_entry *entry;
+
+	LWLockAcquire(time_map_lock, LW_EXCLUSIVE);
+
+	hash_seq_init(&status, time_map);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (entry->key.dboid == dboid &&
+			(!OidIsValid(relnumber) ||
+			 (entry->key.spcoid == spcoid && entry->key.relnumber == relnumber)))
+			hash_search(time_map, &entry->key, HASH_REMOVE, NULL);
+	}
+
+	LWLockRelease(time_map_lock);
+}
+
+/*
+ * time_map_evict
+ *	Make room in a full map by removing the entries that have not been used
+ *	within the last 3/4 * max_ranges ticks of the use clock. Every tick marks
+ *	a use of a single entry, so at least a quarter of the entries is removed.
+ *
+ * Must be called with the lock held exclusively.
+ */
+static void
+time_map_evict(void)
+{
+	HASH_SEQ_STATUS status;
+	uuid_v1_time_map_entry *entry;
+	uint64 clock = pg_atomic_read_u64(&time_map_shared->clock);
+	uint64 window = (uint64) time_map_max_ranges / 4 * 3;
+
+	/* every entry got its own tick when stored, so this is not expected */
+	if (clock < window)
+		return;
+
+	hash_seq_init(&status, time_map);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (pg_atomic_read_u64(&entry->last_used) < clock - window)
+			hash_search(time_map, &entry->key, HASH_REMOVE, NULL);
+	}
+}
+
+/*
+ * time_map_strategy
+ *	Btree strategy of the given operator (plus TIME_MAP_TIMESTAMP if it
+ *	compares with a timestamp), or zero if it is not one of ours.
+ */
+static int
+time_map_strategy(Oid opno)
+{
+	FmgrInfo flinfo;
+	int i;
+
+	fmgr_info(get_opcode(opno), &flinfo);
+
+	for (i = 0; i < lengthof(time_map_operators); i++)
+	{
+		if (flinfo.fn_addr == time_map_operators[i].fn)
+			return time_map_operators[i].strategy;
+	}
+
+	return 0;
+}
+
+/*
+ * time_map_rel_pathlist
+ *	Add a custom scan path for plain heap tables restricted by comparisons of
+ *	a uuid_v1 column with values that are constant during the scan.
+ *
+ * The custom scan reads the blocks a sequential scan would read, except for
+ * the ranges skipped, so the run cost of the sequential scan is reduced by the
+ * fraction of ranges the map shows can't match, and the cost of deciding about
+ * each range is added. If the map shows no range can be skipped, no path is
+ * added at all.
+ */
+static void
+time_map_rel_pathlist(PlannerInfo *root, RelOptInfo *rel, Index rti,
+					  RangeTblEntry *rte)
+{
+	AttrNumber attnum = InvalidAttrNumber;
+	List *strategies = NIL;
+	List *values = NIL;
+	Path *seqpath = NULL;
+	CustomPath *cpath;
+	Relation relation;
+	bool supported;
+	double prunable = 0.0;
+	double nranges;
+	ListCell *lc;
+
+	if (prev_set_rel_pathlist_hook)
+		prev_set_rel_pathlist_hook(root, rel, rti, rte);
+
+	if (time_map == NULL || !time_map_enabled)
+		return;
+
+	if ((rel->reloptkind != RELOPT_BASEREL &&
+		 rel->reloptkind != RELOPT_OTHER_MEMBER_REL) ||
+		rte->rtekind != RTE_RELATION || rte->relkind != RELKIND_RELATION ||
+		rte->inh || rte->tablesample != NULL)
+		return;
+
+	/* only a single column can be used, the first one found */
+	foreach(lc, rel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+		OpExpr *op;
+		Expr *arg;
+		Node *value;
+		int strategy;
+
+		if (rinfo->pseudoconstant || !IsA(rinfo->clause, OpExpr))
+			continue;
+
+		op = (OpExpr *) rinfo->clause;
+		if (list_length(op->args) != 2)
+			continue;
+
+		arg = (Expr *) linitial(op->args);
+		while (IsA(arg, RelabelType))
+			arg = ((RelabelType *) arg)->arg;
+
+		value = (Node *) lsecond(op->args);
+
+		if (!IsA(arg, Var) || ((Var *) arg)->varno != rti ||
+			((Var *) arg)->varlevelsup != 0 || ((Var *) arg)->varattno <= 0 ||
+			(attnum != InvalidAttrNumber && ((Var *) arg)->varattno != attnum))
+			continue;
+
+		if (contain_var_clause(value) || contain_volatile_functions(value))
+			continue;
+
+		strategy = time_map_strategy(op->opno);
+		if (strategy == 0)
+			continue;
+
+		attnum = ((Var *) arg)->varattno;
+		strategies = lappend_int(strategies, strategy);
+		values = lappend(values, value);
+	}
+
+	if (attnum == InvalidAttrNumber)
+		return;
+
+	/* the planner already holds a lock on the relation */
+	relation = table_open(rte->relid, NoLock);
+	supported = relation->rd_rel->relam == HEAP_TABLE_AM_OID &&
+		RelationNeedsWAL(relation);
+	if (supported)
+		prunable = time_map_prunable(relation, rel->pages, attnum, strategies, values);
+	table_close(relation, NoLock);
+
+	if (!supported || prunable <= 0.0)
+		return;
+
+	foreach(lc, rel->pathlist)
+	{
+		Path *path = (Path *) lfirst(lc);
+
+		if (path->pathtype == T_SeqScan && path->param_info == NULL)
+		{
+			seqpath = path;
+			break;
+		}
+	}
+
+	if (seqpath == NULL)
+		return;
+
+	cpath = makeNode(CustomPath);
+	cpath->path.pathtype = T_CustomScan;
+	cpath->path.parent = rel;
+	cpath->path.pathtarget = rel->reltarget;
+	cpath->path.param_info = NULL;
+	cpath->path.parallel_aware = false;
+	cpath->path.parallel_safe = rel->consider_parallel;
+	cpath->path.parallel_workers = 0;
+	cpath->path.rows = seqpath->rows;
+#if PG_VERSION_NUM >= 180000
+	cpath->path.disabled_nodes = seqpath->disabled_nodes;
+#endif
+	nranges = ceil((double) rel->pages / TIME_MAP_RANGE_BLOCKS);
+	cpath->path.startup_cost = seqpath->startup_cost;
+	cpath->path.total_cost = seqpath->startup_cost +
+		(seqpath->total_cost - seqpath->startup_cost) * (1.0 - prunable) +
+		nranges * TIME_MAP_RANGE_COST;
+	cpath->path.pathkeys = NIL;
+	cpath->flags = 0;
+	cpath->custom_paths = NIL;
+	cpath->custom_private = list_make3(makeInteger(attnum), strategies, values);
+	cpath->methods = &time_map_path_methods;
+
+	add_path(rel, &cpath->path);
+}
+
+/*
+ * time_map_plan_path
+ *	Create the custom scan. The comparison values go into custom_exprs, so
+ *	they are processed by setrefs like any other expression.
+ */
+static Plan*
+time_map_plan_path(PlannerInfo *root, RelOptInfo *rel, CustomPath *best_path,
+				   List *tlist, List *clauses, List *custom_plans)
+{
+	CustomScan *cscan = makeNode(CustomScan);
+
+	cscan->scan.plan.targetlist = tlist;
+	cscan->scan.plan.qual = extract_actual_clauses(clauses, false);
+	cscan->scan.scanrelid = rel->relid;
+	cscan->flags = best_path->flags;
+	cscan->custom_exprs = (List *) lthird(best_path->custom_private);
+	cscan->custom_private = list_make2(linitial(best_path->custom_private),
+									   lsecond(best_path->custom_private));
+	cscan->methods = &time_map_scan_methods;
+
+	return &cscan->scan.plan;
+}
+
+static Node*
+time_map_create_state(CustomScan *cscan)
+{
+	uuid_v1_time_map_state *state = palloc0(sizeof(uuid_v1_time_map_state));
+
+	NodeSetTag(state, T_CustomScanState);
+	state->css.methods = &time_map_exec_methods;
+#if PG_VERSION_NUM >= 150000
+	/* tuples are stored in the slot by the heap scan */
+	state->css.slotOps = &TTSOpsBufferHeapTuple;
+#endif
+	state->attnum = intVal(linitial(cscan->custom_private));
+	state->strategies = (List *) lsecond(cscan->custom_private);
+	state->vmbuffer = InvalidBuffer;
+
+	return (Node *) state;
+}
+
+static void
+time_map_begin(CustomScanState *node, EState *estate, int eflags)
+{
+	uuid_v1_time_map_state *state = (uuid_v1_time_map_state *) node;
+	CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
+	Relation rel = node->ss.ss_currentRelation;
+
+#if PG_VERSION_NUM < 150000
+	/*
+	 * The scan slot has been created as a virtual one, so replace it by one
+	 * the heap scan can store its tuples in and set up the qual and the
+	 * projection for the new slot again.
+	 */
+	ExecInitScanTupleSlot(estate, &node->ss, RelationGetDescr(rel),
+						  table_slot_callbacks(rel));
+	ExecAssignScanProjectionInfoWithVarno(&node->ss, cscan->scan.scanrelid);
+	node->ss.ps.qual = ExecInitQual(cscan->scan.plan.qual, (PlanState *) node);
+#endif
+
+	state->bounds = ExecInitExprList(cscan->custom_exprs, &node->ss.ps);
+
+	/* the relation might be new in this transaction and not WAL-logged yet */
+	state->use_map = time_map != NULL && RelationNeedsWAL(rel);
+
+	time_map_set_key(rel, state->attnum, &state->current.key);
+}
+
+static TupleTableSlot*
+time_map_exec(CustomScanState *node)
+{
+	return ExecScan(&node->ss, time_map_next, time_map_recheck);
+}
+
+static void
+time_map_end(CustomScanState *node)
+{
+	uuid_v1_time_map_state *state = (uuid_v1_time_map_state *) node;
+
+	if (state->scan)
+		table_endscan(state->scan);
+
+	if (BufferIsValid(state->vmbuffer))
+		ReleaseBuffer(state->vmbuffer);
+}
+
+static void
+time_map_rescan(CustomScanState *node)
+{
+	uuid_v1_time_map_state *state = (uuid_v1_time_map_state *) node;
+
+	/* the comparison values might have changed */
+	state->started = false;
+	state->in_range = false;
+
+	ExecScanReScan(&node->ss);
+}
+
+static void
+time_map_explain(CustomScanState *node, List *ancestors, ExplainState *es)
+{
+	uuid_v1_time_map_state *state = (uuid_v1_time_map_state *) node;
+
+	if (es->analyze)
+	{
+		ExplainPropertyInteger("Ranges Skipped", NULL, state->ranges_skipped, es);
+		ExplainPropertyInteger("Ranges Summarized", NULL, state->ranges_summarized, es);
+	}
+}
+
+/*
+ * time_map_prunable
+ *	Estimate the fraction of ranges of the relation that a scan skips, by
+ *	looking up a sample of evenly spaced ranges in the map.
+ *
+ * Only the comparison values known at plan time are taken into account, and
+ * the summaries are not checked against the visibility map.
+ */
+static double
+time_map_prunable(Relation rel, BlockNumber pages, AttrNumber attnum,
+				  List *strategies, List *values)
+{
+	uuid_v1_time_map_key key;
+	BlockNumber nranges = (pages + TIME_MAP_RANGE_BLOCKS - 1) / TIME_MAP_RANGE_BLOCKS;
+	BlockNumber step = Max(1, nranges / TIME_MAP_COST_SAMPLES);
+	BlockNumber range;
+	int64 lo = PG_INT64_MIN;
+	int64 hi = PG_INT64_MAX;
+	int sampled = 0;
+	int skipped = 0;
+	ListCell *lc1, *lc2;
+
+	forboth(lc1, values, lc2, strategies)
+	{
+		Node *value = (Node *) lfirst(lc1);
+
+		if (IsA(value, Const) && !((Const *) value)->constisnull)
+			time_map_narrow(lfirst_int(lc2), ((Const *) value)->constvalue, &lo, &hi);
+	}
+
+	if (nranges == 0)
+		return 0.0;
+
+	time_map_set_key(rel, attnum, &key);
+
+	LWLockAcquire(time_map_lock, LW_SHARED);
+
+	for (range = 0; range < nranges; range += step)
+	{
+		uuid_v1_time_map_entry *entry;
+
+		key.range = range;
+		entry = hash_search(time_map, &key, HASH_FIND, NULL);
+
+		if (entry != NULL &&
+			(entry->min_ts > entry->max_ts || entry->max_ts < lo || entry->min_ts > hi))
+			skipped++;
+		sampled++;
+	}
+
+	LWLockRelease(time_map_lock);
+
+	return (double) skipped / sampled;
+}
+
+/*
+ * time_map_narrow
+ *	Narrow down the range of UUID timestamps a matching row can have, given
+ *	a (non-NULL) comparison value.
+ *
+ * Values that can't be converted into a timestamp without overflowing are
+ * ignored, that only makes the bounds less tight.
+ */
+static void
+time_map_narrow(int strategy, Datum value, int64 *lo, int64 *hi)
+{
+	int64 ticks;
+
+	if (strategy & TIME_MAP_TIMESTAMP)
+	{
+		TimestampTz ts = DatumGetTimestampTz(value);
+
+		if (TIMESTAMP_NOT_FINITE(ts) ||
+			pg_mul_s64_overflow(ts, 10, &ticks) ||
+			pg_add_s64_overflow(ticks, to_uuid_timestamp(0), &ticks))
+			return;
+
+		/* comparisons with a timestamp only look at the UUID timestamp */
+		if (strategy == (BTLessStrategyNumber | TIME_MAP_TIMESTAMP) &&
+			pg_sub_s64_overflow(ticks, 1, &ticks))
+			return;
+		if (strategy == (BTGreaterStrategyNumber | TIME_MAP_TIMESTAMP) &&
+			pg_add_s64_overflow(ticks, 1, &ticks))
+			return;
+
+		strategy &= ~TIME_MAP_TIMESTAMP;
+	}
+	else
+		ticks = DatumGetUUIDV1P(value)->timestamp;
+
+	/* UUID's with equal timestamps still differ in the other fields */
+	if (strategy != BTGreaterEqualStrategyNumber &&
+		strategy != BTGreaterStrategyNumber)
+		*hi = Min(*hi, ticks);
+	if (strategy != BTLessEqualStrategyNumber &&
+		strategy != BTLessStrategyNumber)
+		*lo = Max(*lo, ticks);
+}
+
+/*
+ * time_map_bounds
+ *	Evaluate the comparison values and narrow down the range of UUID
+ *	timestamps a matching row can have.
+ */
+static void
+time_map_bounds(uuid_v1_time_map_state *state)
+{
+	ExprContext *econtext = state->css.ss.ps.ps_ExprContext;
+	ListCell *lc1, *lc2;
+
+	state->lo = PG_INT64_MIN;
+	state->hi = PG_INT64_MAX;
+	state->empty = false;
+
+	forboth(lc1, state->bounds, lc2, state->strategies)
+	{
+		bool isnull;
+		Datum value;
+
+		value = ExecEvalExprSwitchContext((ExprState *) lfirst(lc1), econtext, &isnull);
+
+		/* the operators are strict */
+		if (isnull)
+		{
+			state->empty = true;
+			continue;
+		}
+
+		time_map_narrow(lfirst_int(lc2), value, &state->lo, &state->hi);
+	}
+
+	if (state->lo > state->hi)
+		state->empty = true;
+}
+
+/*
+ * time_map_set_key
+ *	Initialize the key of the ranges of a column of the relation, including
+ *	its padding, leaving the range number at zero.
+ */
+static void
+time_map_set_key(Relation rel, AttrNumber attnum, uuid_v1_time_map_key *key)
+{
+	memset(key, 0, sizeof(uuid_v1_time_map_key));
+#if PG_VERSION_NUM >= 160000
+	key->spcoid = rel->rd_locator.spcOid;
+	key->dboid = rel->rd_locator.dbOid;
+	key->relnumber = rel->rd_locator.relNumber;
+#else
+	key->spcoid = rel->rd_node.spcNode;
+	key->dboid = rel->rd_node.dbNode;
+	key->relnumber = rel->rd_node.relNode;
+#endif
+	key->attnum = attnum;
+}
+
+/*
+ * time_map_visible
+ *	Check whether all blocks in the given range are all-visible and return
+ *	the LSN's of the visibility map pages covering the first and the last
+ *	block.
+ *
+ * The bits are read without a lock, but the LSN is read while holding a
+ * share lock on the visibility map page. Setting the bits happens under an
+ * exclusive lock which is only released after the LSN was advanced, so if we
+ * saw the bits being set, we see the new LSN as well.
+ */
+static bool
+time_map_visible(Relation rel, Buffer *vmbuffer, BlockNumber start,
+				 BlockNumber end, XLogRecPtr *lsn_first, XLogRecPtr *lsn_last)
+{
+	BlockNumber first = start;
+
+	while (start < end)
+	{
+		BlockNumber stop = Min(end, (start / TIME_MAP_VM_BLOCKS + 1) * TIME_MAP_VM_BLOCKS);
+		BlockNumber blkno;
+		XLogRecPtr lsn;
+
+		for (blkno = start; blkno < stop; blkno++)
+		{
+			if ((visibilitymap_get_status(rel, blkno, vmbuffer) &
+				 VISIBILITYMAP_ALL_VISIBLE) == 0)
+				return false;
+		}
+
+		LockBuffer(*vmbuffer, BUFFER_LOCK_SHARE);
+		lsn = PageGetLSN(BufferGetPage(*vmbuffer));
+		LockBuffer(*vmbuffer, BUFFER_LOCK_UNLOCK);
+
+		/* bits set without WAL-logging can't be tracked */
+		if (XLogRecPtrIsInvalid(lsn))
+			return false;
+
+		if (start == first)
+			*lsn_first = lsn;
+		*lsn_last = lsn;
+
+		start = stop;
+	}
+
+	return true;
+}
+
+/*
+ * time_map_skip_range
+ *	Check whether the map holds a valid summary of the range showing that no
+ *	row in it can match.
+ */
+static bool
+time_map_skip_range(uuid_v1_time_map_state *state, BlockNumber start,
+					BlockNumber end)
+{
+	uuid_v1_time_map_entry *entry;
+	uuid_v1_time_map_entry summary;
+	XLogRecPtr lsn_first;
+	XLogRecPtr lsn_last;
+	bool found;
+
+	LWLockAcquire(time_map_lock, LW_SHARED);
+
+	entry = hash_search(time_map, &state->current.key, HASH_FIND, &found);
+	if (found)
+	{
+		summary = *entry;
+		pg_atomic_write_u64(&entry->last_used,
+							pg_atomic_fetch_add_u64(&time_map_shared->clock, 1));
+	}
+
+	LWLockRelease(time_map_lock);
+
+	if (!found)
+		return false;
+
+	if (summary.min_ts <= summary.max_ts &&
+		summary.max_ts >= state->lo && summary.min_ts <= state->hi)
+		return false;
+
+	return time_map_visible(state->css.ss.ss_currentRelation, &state->vmbuffer,
+							start, end, &lsn_first, &lsn_last) &&
+		lsn_first == summary.lsn_first && lsn_last == summary.lsn_last;
+}
+
+/*
+ * time_map_store_range
+ *	Record the summary of the range just read, if its blocks did not change
+ *	while we were reading them. If the map is full, the least recently used
+ *	entries are evicted first. Returns whether the summary was recorded.
+ */
+static bool
+time_map_store_range(Relation rel, Buffer *vmbuffer,
+					 uuid_v1_time_map_entry *summary, BlockNumber start,
+					 BlockNumber end)
+{
+	uuid_v1_time_map_entry *entry;
+	XLogRecPtr lsn_first;
+	XLogRecPtr lsn_last;
+
+	if (!time_map_visible(rel, vmbuffer, start, end, &lsn_first, &lsn_last) ||
+		lsn_first != summary->lsn_first || lsn_last != summary->lsn_last)
+		return false;
+
+	LWLockAcquire(time_map_lock, LW_EXCLUSIVE);
+
+	entry = hash_search(time_map, &summary->key, HASH_FIND, NULL);
+	if (entry == NULL)
+	{
+		if (hash_get_num_entries(time_map) >= time_map_max_ranges)
+			time_map_evict();
+
+		/* the key is set by hash_search, including its padding */
+		entry = hash_search(time_map, &summary->key, HASH_ENTER, NULL);
+		pg_atomic_init_u64(&entry->last_used, 0);
+	}
+
+	entry->min_ts = summary->min_ts;
+	entry->max_ts = summary->max_ts;
+	entry->lsn_first = summary->lsn_first;
+	entry->lsn_last = summary->lsn_last;
+	pg_atomic_write_u64(&entry->last_used,
+						pg_atomic_fetch_add_u64(&time_map_shared->clock, 1));
+
+	LWLockRelease(time_map_lock);
+
+	return true;
+}
+
+/*
+ * time_map_next
+ *	Return the next tuple, reading the table range by range.
+ */
+static TupleTableSlot*
+time_map_next(ScanState *ss)
+{
+	uuid_v1_time_map_state *state = (uuid_v1_time_map_state *) ss;
+	TupleTableSlot *slot = ss->ss_ScanTupleSlot;
+
+	if (!state->started)
+	{
+		EState *estate = ss->ps.state;
+
+		time_map_bounds(state);
+
+		/* synchronized scans can't be limited to a range of blocks */
+		if (state->scan == NULL)
+			state->scan = table_beginscan_strat(ss->ss_currentRelation,
+												estate->es_snapshot,
+												0, NULL, true, false);
+		else
+			table_rescan(state->scan, NULL);
+
+		state->nblocks = ((HeapScanDesc) state->scan)->rs_nblocks;
+		state->next_range = 0;
+		state->started = true;
+	}
+
+	for (;;)
+	{
+		BlockNumber start;
+		BlockNumber end;
+
+		if (state->in_range)
+		{
+			if (table_scan_getnextslot(state->scan, ForwardScanDirection, slot))
+			{
+				if (state->summarize)
+				{
+					bool isnull;
+					Datum value = slot_getattr(slot, state->attnum, &isnull);
+
+					if (!isnull)
+					{
+						int64 ticks = DatumGetUUIDV1P(value)->timestamp;
+
+						state->current.min_ts = Min(state->current.min_ts, ticks);
+						state->current.max_ts = Max(state->current.max_ts, ticks);
+					}
+				}
+
+				return slot;
+			}
+
+			state->in_range = false;
+
+			if (state->summarize)
+			{
+				start = (state->next_range - 1) * TIME_MAP_RANGE_BLOCKS;
+				end = Min(state->nblocks, start + TIME_MAP_RANGE_BLOCKS);
+				if (time_map_store_range(ss->ss_currentRelation, &state->vmbuffer,
+										 &state->current, start, end))
+					state->ranges_summarized++;
+			}
+		}
+
+		if (state->empty || state->next_range * TIME_MAP_RANGE_BLOCKS >= state->nblocks)
+			return ExecClearTuple(slot);
+
+		CHECK_FOR_INTERRUPTS();
+
+		start = state->next_range * TIME_MAP_RANGE_BLOCKS;
+		end = Min(state->nblocks, start + TIME_MAP_RANGE_BLOCKS);
+		state->current.key.range = state->next_range++;
+
+		if (state->use_map && time_map_skip_range(state, start, end))
+		{
+			state->ranges_skipped++;
+			continue;
+		}
+
+		/* summarize the range if it is not going to change */
+		state->summarize = state->use_map &&
+			time_map_visible(ss->ss_currentRelation, &state->vmbuffer, start, end,
+							 &state->current.lsn_first, &state->current.lsn_last);
+		state->current.min_ts = PG_INT64_MAX;
+		state->current.max_ts = PG_INT64_MIN;
+
+		table_rescan(state->scan, NULL);
+		heap_setscanlimits(state->scan, start, end - start);
+		state->in_range = true;
+	}
+}
+
+/*
+ * time_map_recheck
+ *	Nothing to check beyond the scan quals.
+ */
+static bool
+time_map_recheck(ScanState *ss, TupleTableSlot *slot)
+{
+	return true;
+}
+
+/*
+ * uuid_v1_time_map_summarize
+ *	Summarize all ranges of the relation which are all-visible, so that scans
+ *	on the column can skip ranges right away. Returns the number of ranges
+ *	recorded in the map.
+ */
+Datum
+uuid_v1_time_map_summarize(PG_FUNCTION_ARGS)
+{
+	Oid relid = PG_GETARG_OID(0);
+	Name column = PG_GETARG_NAME(1);
+	Relation rel;
+	AclResult aclresult;
+	TableScanDesc scan;
+	TupleTableSlot *slot;
+	Buffer vmbuffer = InvalidBuffer;
+	uuid_v1_time_map_entry summary;
+	BlockNumber nblocks;
+	BlockNumber start;
+	int64 stored = 0;
+
+	if (time_map == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				errmsg("uuid_v1 time map must be loaded via shared_preload_libraries")));
+
+	rel = table_open(relid, AccessShareLock);
+
+	if (rel->rd_rel->relkind != RELKIND_RELATION ||
+		rel->rd_rel->relam != HEAP_TABLE_AM_OID)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				errmsg("\"%s\" is not a heap table",
+					   RelationGetRelationName(rel))));
+
+	/* reading the rows requires the privilege to select from the table */
+	aclresult = pg_class_aclcheck(relid, GetUserId(), ACL_SELECT);
+	if (aclresult != ACLCHECK_OK)
+		aclcheck_error(aclresult, get_relkind_objtype(rel->rd_rel->relkind),
+					   RelationGetRelationName(rel));
+
+	if (!RelationNeedsWAL(rel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				errmsg("ranges of unlogged or temporary table \"%s\" can't be summarized",
+					   RelationGetRelationName(rel))));
+
+	time_map_set_key(rel, get_attnum(relid, NameStr(*column)), &summary.key);
+
+	if (summary.key.attnum == InvalidAttrNumber)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_COLUMN),
+				errmsg("column \"%s\" of relation \"%s\" does not exist",
+					   NameStr(*column), RelationGetRelationName(rel))));
+
+	if (summary.key.attnum < 0 ||
+		getBaseType(TupleDescAttr(RelationGetDescr(rel), summary.key.attnum - 1)->atttypid) !=
+		uuid_v1_type_oid(fcinfo->flinfo->fn_oid))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATATYPE_MISMATCH),
+				errmsg("column \"%s\" is not of type uuid_v1",
+					   NameStr(*column))));
+
+	/* synchronized scans can't be limited to a range of blocks */
+	scan = table_beginscan_strat(rel, GetActiveSnapshot(), 0, NULL, true, false);
+	slot = table_slot_create(rel, NULL);
+	nblocks = ((HeapScanDesc) scan)->rs_nblocks;
+
+	for (start = 0; start < nblocks; start += TIME_MAP_RANGE_BLOCKS)
+	{
+		BlockNumber end = Min(nblocks, start + TIME_MAP_RANGE_BLOCKS);
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* ranges which may still change are left alone */
+		if (!time_map_visible(rel, &vmbuffer, start, end,
+							  &summary.lsn_first, &summary.lsn_last))
+			continue;
+
+		summary.key.range = start / TIME_MAP_RANGE_BLOCKS;
+		summary.min_ts = PG_INT64_MAX;
+		summary.max_ts = PG_INT64_MIN;
+
+		table_rescan(scan, NULL);
+		heap_setscanlimits(scan, start, end - start);
+
+		while (table_scan_getnextslot(scan, ForwardScanDirection, slot))
+		{
+			bool isnull;
+			Datum value = slot_getattr(slot, summary.key.attnum, &isnull);
+
+			if (!isnull)
+			{
+				int64 ticks = DatumGetUUIDV1P(value)->timestamp;
+
+				summary.min_ts = Min(summary.min_ts, ticks);
+				summary.max_ts = Max(summary.max_ts, ticks);
+			}
+		}
+
+		if (time_map_store_range(rel, &vmbuffer, &summary, start, end))
+			stored++;
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	table_endscan(scan);
+
+	if (BufferIsValid(vmbuffer))
+		ReleaseBuffer(vmbuffer);
+
+	table_close(rel, AccessShareLock);
+
+	PG_RETURN_INT64(stored);
+}